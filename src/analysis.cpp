@@ -0,0 +1,467 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "analysis.h"
+
+#include <QHash>
+#include <QJsonArray>
+
+#include <algorithm>
+#include <vector>
+
+#include "dataobject.h"
+#include "hwtopo.h"
+
+// Samples and load latency accumulated for one summary row
+struct Aggregate
+{
+    Aggregate() : samples(0), cycles(0) {}
+
+    qulonglong samples;
+    qlonglong cycles;
+};
+
+typedef std::pair<quint64,Aggregate> KeyedAggregate;
+
+static bool moreCycles(const KeyedAggregate &a, const KeyedAggregate &b)
+{
+    if(a.second.cycles != b.second.cycles)
+        return a.second.cycles > b.second.cycles;
+    return a.second.samples > b.second.samples;
+}
+
+static QString cellText(const QVariant &v)
+{
+    if(v.type() == QVariant::Double)
+        return QString::number(v.toDouble(),'f',2);
+    return v.toString();
+}
+
+QString ResultTable::toText() const
+{
+    QVector<int> widths(columns.size());
+    for(int c=0; c<columns.size(); c++)
+        widths[c] = columns[c].size();
+
+    QVector<QStringList> cells;
+    for(int r=0; r<rows.size(); r++)
+    {
+        QStringList rowCells;
+        for(int c=0; c<columns.size(); c++)
+        {
+            QString cell = cellText(rows[r].value(c));
+            widths[c] = std::max(widths[c], cell.size());
+            rowCells << cell;
+        }
+        cells.push_back(rowCells);
+    }
+
+    QString text = title + "\n";
+
+    QStringList header;
+    QStringList rule;
+    for(int c=0; c<columns.size(); c++)
+    {
+        header << columns[c].leftJustified(widths[c]);
+        rule << QString(widths[c],'-');
+    }
+    text += header.join("  ") + "\n" + rule.join("  ") + "\n";
+
+    // Text left-aligned, numbers right-aligned
+    for(int r=0; r<cells.size(); r++)
+    {
+        QStringList line;
+        for(int c=0; c<columns.size(); c++)
+        {
+            if(rows[r].value(c).type() == QVariant::String)
+                line << cells[r][c].leftJustified(widths[c]);
+            else
+                line << cells[r][c].rightJustified(widths[c]);
+        }
+        text += line.join("  ") + "\n";
+    }
+
+    return text;
+}
+
+QJsonObject ResultTable::toJson() const
+{
+    QJsonArray jsonColumns;
+    for(int c=0; c<columns.size(); c++)
+        jsonColumns.append(columns[c]);
+
+    QJsonArray jsonRows;
+    for(int r=0; r<rows.size(); r++)
+    {
+        QJsonObject row;
+        for(int c=0; c<columns.size(); c++)
+            row.insert(columns[c], QJsonValue::fromVariant(rows[r].value(c)));
+        jsonRows.append(row);
+    }
+
+    QJsonObject json;
+    json.insert("title", title);
+    json.insert("columns", jsonColumns);
+    json.insert("rows", jsonRows);
+    return json;
+}
+
+CMD_TYPE getCommandType(QString cmd)
+{
+    cmd = cmd.toLower();
+    if(cmd == "help" || cmd == "h")
+        return CMD_HELP;
+    else if(cmd == "select" || cmd == "sel")
+        return CMD_SELECT;
+    else if(cmd == "inspect" || cmd == "ins")
+        return CMD_INSPECT;
+    else if(cmd == "resources" || cmd == "res")
+        return CMD_RESOURCES;
+    else if(cmd == "variables" || cmd == "vars")
+        return CMD_VARIABLES;
+    else if(cmd == "lines")
+        return CMD_LINES;
+    else if(cmd == "group" || cmd == "grp")
+        return CMD_GROUP;
+    else if(cmd == "undo")
+        return CMD_UNDO;
+    else if(cmd == "redo")
+        return CMD_REDO;
+    return CMD_UNKNOWN;
+}
+
+QUERY_TYPE getQueryType(QString qtype)
+{
+    qtype = qtype.toLower();
+    if(qtype == "dimrange")
+        return QUERY_DIMRANGE;
+    else if(qtype == "resource")
+        return QUERY_RESOURCE;
+    return QUERY_UNKNOWN;
+}
+
+QString parseDimRangeQuery(const QStringList &args, int first, dimRangeQuery &drq)
+{
+    for(int i=first; i<args.size(); i++)
+    {
+        QStringList eqSplit = args[i].split("=");
+        if(eqSplit.size() != 2)
+            return "Invalid range "+args[i];
+
+        QStringList rangeStrs = eqSplit[1].split(":");
+        if(rangeStrs.size() != 2)
+            return "Invalid range "+args[i];
+
+        bool dimOk, minOk, maxOk;
+        int dim = eqSplit[0].toInt(&dimOk);
+        qreal vmin = rangeStrs[0].toDouble(&minOk);
+        qreal vmax = rangeStrs[1].toDouble(&maxOk);
+
+        if(!dimOk || dim < 0 || dim >= NUM_SAMPLE_AXES)
+            return "Invalid dimension "+eqSplit[0];
+        if(!minOk || !maxOk)
+            return "Invalid range "+args[i];
+
+        drq.dims.push_back(dim);
+        drq.mins.push_back(vmin);
+        drq.maxes.push_back(vmax);
+    }
+
+    return QString();
+}
+
+QString runSelectCommand(DataObject *dataSet, const QStringList &args)
+{
+    if(dataSet == NULL || dataSet->empty())
+        return "Unable to select from the void, please load data first";
+
+    if(args.size() < 3)
+        return "Invalid arguments";
+
+    QUERY_TYPE qt = getQueryType(args.at(1));
+
+    if(qt == QUERY_DIMRANGE)
+    {
+        dimRangeQuery drq;
+        QString err = parseDimRangeQuery(args, 2, drq);
+        if(!err.isEmpty())
+            return err;
+
+        dataSet->selectByMultiDimRange(drq.dims,drq.mins,drq.maxes);
+        return QString();
+    }
+    else if(qt == QUERY_RESOURCE)
+    {
+        return "RESOURCE queries are not supported yet";
+    }
+
+    return "Invalid arguments";
+}
+
+// Group number 1..MAX_SELECTION_GROUPS, or -1
+static int groupArgument(const QString &arg)
+{
+    bool ok;
+    int group = arg.toInt(&ok);
+    return (ok && group >= 1 && group <= MAX_SELECTION_GROUPS) ? group : -1;
+}
+
+QString runGroupCommand(DataObject *dataSet, const QStringList &args, bool *selectionChanged)
+{
+    *selectionChanged = false;
+
+    if(args.size() == 2)
+    {
+        int group = groupArgument(args[1]);
+        if(group == -1)
+            return "Invalid group "+args[1];
+
+        dataSet->setActiveGroup(group);
+        return QString();
+    }
+
+    if(args.size() != 6 || args[2] != "=")
+        return "Invalid arguments";
+
+    int dst = groupArgument(args[1]);
+    int a = groupArgument(args[3]);
+    int b = groupArgument(args[5]);
+    if(dst == -1 || a == -1 || b == -1)
+        return "Invalid group";
+
+    group_op op;
+    if(args[4] == "|")
+        op = GROUP_UNION;
+    else if(args[4] == "&")
+        op = GROUP_INTERSECTION;
+    else if(args[4] == "-")
+        op = GROUP_DIFFERENCE;
+    else
+        return "Invalid operator "+args[4];
+
+    dataSet->combineGroups(dst, a, b, op);
+    *selectionChanged = true;
+    return QString();
+}
+
+int topRowsArgument(const QStringList &args)
+{
+    if(args.size() < 2)
+        return DEFAULT_TOP_ROWS;
+
+    bool ok;
+    int n = args[1].toInt(&ok);
+    return (ok && n > 0) ? n : DEFAULT_TOP_ROWS;
+}
+
+ResultTable selectionSummary(DataObject *dataSet)
+{
+    ResultTable table;
+    table.title = "Selection";
+    table.columns << "total samples" << "visible samples" << "selected samples"
+                  << "mean latency" << "latency stddev";
+
+    QVariantList row;
+    row << (qulonglong)dataSet->numElements
+        << (qulonglong)dataSet->numVisible
+        << (qulonglong)dataSet->numSelected;
+    if(dataSet->empty())
+        row << 0.0 << 0.0;
+    else
+        row << dataSet->selectionMeanAt(SampleAxes::latency)
+            << dataSet->selectionStddevAt(SampleAxes::latency);
+    table.rows << row;
+
+    return table;
+}
+
+ResultTable groupSummary(DataObject *dataSet)
+{
+    ResultTable table;
+    table.title = "Selection groups (active: "+QString::number(dataSet->activeGroup())+")";
+    table.columns << "group" << "samples" << "mean latency" << "latency stddev";
+
+    for(int g=1; g<=MAX_SELECTION_GROUPS; g++)
+    {
+        const CoMoments &m = dataSet->groupMoments(g);
+        if(m.count == 0 && g != dataSet->activeGroup())
+            continue;
+
+        table.rows << (QVariantList()
+                       << g
+                       << (qulonglong)m.count
+                       << (m.count ? m.mean[SampleAxes::latency] : 0.0)
+                       << qSqrt(m.covariance(SampleAxes::latency,SampleAxes::latency)));
+    }
+
+    return table;
+}
+
+ResultTable resourceSummary(DataObject *dataSet)
+{
+    ResultTable table;
+    table.title = "Hardware resources";
+    table.columns << "depth" << "type" << "id" << "name"
+                  << "samples" << "cycles" << "mean latency" << "transactions";
+
+    if(dataSet->node == NULL)
+        return table;
+
+    // Same totals as the hardware topology view
+    const ComponentTable &components = dataSet->components();
+    for(int r=0; r<components.size(); r++)
+    {
+        const ComponentAggregate &agg = components.at(r);
+        Component *c = agg.component;
+        qreal meanLatency = agg.selSamples ? (qreal)agg.selCycles / agg.selSamples : 0;
+
+        table.rows << (QVariantList()
+                       << agg.depth
+                       << QString::fromStdString(c->GetComponentTypeStr())
+                       << c->GetId()
+                       << QString::fromStdString(c->GetName())
+                       << agg.selSamples
+                       << agg.selCycles
+                       << meanLatency
+                       << agg.transactions);
+    }
+
+    return table;
+}
+
+// Sorts the aggregates by cycles and keeps the first numRows
+static void keepTopRows(std::vector<KeyedAggregate> &aggs, int numRows)
+{
+    size_t n = std::min(aggs.size(), (size_t)numRows);
+    std::partial_sort(aggs.begin(), aggs.begin()+n, aggs.end(), moreCycles);
+    aggs.resize(n);
+}
+
+static QString internedName(const StringInterner &names, quint64 id)
+{
+    return (id < (quint64)names.size()) ? names.at(id) : QString::number(id);
+}
+
+ResultTable topVariables(DataObject *dataSet, int numRows)
+{
+    ResultTable table;
+    table.title = "Top variables by cycles";
+    table.columns << "variable" << "samples" << "cycles" << "mean latency" << "% cycles";
+
+    const long long *variables = dataSet->samples.column(SampleAxes::variableUid);
+    const long long *latencies = dataSet->samples.column(SampleAxes::latency);
+
+    // Variable IDs are dense interner IDs
+    std::vector<Aggregate> byVariable(dataSet->variableNames.size());
+    qlonglong totalCycles = 0;
+
+    dataSet->topoSelection().forEach([&](ElemIndex elem)
+    {
+        quint64 var = variables[elem];
+        if(var >= byVariable.size())
+            byVariable.resize(var+1);
+        byVariable[var].samples++;
+        byVariable[var].cycles += latencies[elem];
+        totalCycles += latencies[elem];
+    });
+
+    std::vector<KeyedAggregate> aggs;
+    for(size_t v=0; v<byVariable.size(); v++)
+    {
+        if(byVariable[v].samples)
+            aggs.push_back(KeyedAggregate(v, byVariable[v]));
+    }
+    keepTopRows(aggs, numRows);
+
+    for(size_t i=0; i<aggs.size(); i++)
+    {
+        const Aggregate &a = aggs[i].second;
+        table.rows << (QVariantList()
+                       << internedName(dataSet->variableNames, aggs[i].first)
+                       << a.samples
+                       << a.cycles
+                       << (qreal)a.cycles / a.samples
+                       << (totalCycles ? 100.0 * a.cycles / totalCycles : 0.0));
+    }
+
+    return table;
+}
+
+ResultTable topLines(DataObject *dataSet, int numRows)
+{
+    ResultTable table;
+    table.title = "Top source lines by cycles";
+    table.columns << "source file" << "line" << "samples" << "cycles" << "mean latency" << "% cycles";
+
+    const long long *sources = dataSet->samples.column(SampleAxes::sourceUid);
+    const long long *lines = dataSet->samples.column(SampleAxes::line);
+    const long long *latencies = dataSet->samples.column(SampleAxes::latency);
+
+    // Keyed by source ID in the high and line in the low 32 bits
+    QHash<quint64,Aggregate> byLine;
+    qlonglong totalCycles = 0;
+
+    dataSet->topoSelection().forEach([&](ElemIndex elem)
+    {
+        quint64 key = ((quint64)sources[elem] << 32) | (quint32)lines[elem];
+        Aggregate &a = byLine[key];
+        a.samples++;
+        a.cycles += latencies[elem];
+        totalCycles += latencies[elem];
+    });
+
+    std::vector<KeyedAggregate> aggs;
+    aggs.reserve(byLine.size());
+    for(QHash<quint64,Aggregate>::const_iterator it = byLine.constBegin(); it != byLine.constEnd(); ++it)
+        aggs.push_back(KeyedAggregate(it.key(), it.value()));
+    keepTopRows(aggs, numRows);
+
+    for(size_t i=0; i<aggs.size(); i++)
+    {
+        const Aggregate &a = aggs[i].second;
+        table.rows << (QVariantList()
+                       << internedName(dataSet->sourceNames, aggs[i].first >> 32)
+                       << (qint32)(quint32)aggs[i].first
+                       << a.samples
+                       << a.cycles
+                       << (qreal)a.cycles / a.samples
+                       << (totalCycles ? 100.0 * a.cycles / totalCycles : 0.0));
+    }
+
+    return table;
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QJsonObject>
+
+class DataObject;
+
+// Commands shared by the GUI console and memaxes-cli
+enum CMD_TYPE {
+    CMD_HELP = 0,
+    CMD_SELECT,
+    CMD_INSPECT,
+    CMD_RESOURCES,
+    CMD_VARIABLES,
+    CMD_LINES,
+    CMD_GROUP,
+    CMD_UNDO,
+    CMD_REDO,
+    CMD_UNKNOWN
+};
+
+enum QUERY_TYPE {
+    QUERY_DIMRANGE = 0,
+    QUERY_RESOURCE,
+    QUERY_UNKNOWN
+};
+
+struct dimRangeQuery {
+    QVector<int> dims;
+    QVector<qreal> mins;
+    QVector<qreal> maxes;
+};
+
+#define DEFAULT_TOP_ROWS 10
+
+// Result of a summary query; rows hold one value per column
+struct ResultTable
+{
+    QString title;
+    QStringList columns;
+    QList<QVariantList> rows;
+
+    // Aligned plain-text table
+    QString toText() const;
+    // {"title": ..., "columns": [...], "rows": [{column: value, ...}, ...]}
+    QJsonObject toJson() const;
+};
+
+CMD_TYPE getCommandType(QString cmd);
+QUERY_TYPE getQueryType(QString qtype);
+
+// Parses "dim=vmin:vmax" terms from args[first...]. Returns an error
+// message, or an empty string on success.
+QString parseDimRangeQuery(const QStringList &args, int first, dimRangeQuery &drq);
+
+// Runs "select <query>" on the data set in its current selection mode.
+// Returns an error message, or an empty string on success. The caller
+// announces the selection change (DataObject::selectionChanged).
+QString runSelectCommand(DataObject *dataSet, const QStringList &args);
+
+// Runs "group <n>" (make n the active group) or "group <dst> = <a> <op> <b>"
+// with op one of | & - (union, intersection, difference). Returns an
+// error message, or an empty string on success; selectionChanged is set
+// when group members changed.
+QString runGroupCommand(DataObject *dataSet, const QStringList &args, bool *selectionChanged);
+
+// Row limit argument of the top-N commands, e.g. "vars 20"
+int topRowsArgument(const QStringList &args);
+
+// Summaries over the selected samples, or all samples if none are selected
+ResultTable selectionSummary(DataObject *dataSet);
+ResultTable groupSummary(DataObject *dataSet);
+ResultTable resourceSummary(DataObject *dataSet);
+ResultTable topVariables(DataObject *dataSet, int numRows = DEFAULT_TOP_ROWS);
+ResultTable topLines(DataObject *dataSet, int numRows = DEFAULT_TOP_ROWS);
+
+#endif // ANALYSIS_H
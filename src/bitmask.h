@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <QVector>
+
+#include "elemset.h"
+
+// Dense bitmap with one bit per element, stored in 64-bit words so that
+// whole-set operations work a word at a time. Copies are implicitly
+// shared, which keeps snapshots for background jobs cheap.
+class BitMask
+{
+public:
+    BitMask() : numBits(0) {}
+
+    ElemIndex size() const { return numBits; }
+
+    // Resizes to n bits, all set to value
+    void reset(ElemIndex n, bool value);
+    void fill(bool value);
+
+    bool testBit(ElemIndex i) const { return (words.constData()[i >> 6] >> (i & 63)) & 1; }
+    void setBit(ElemIndex i) { words[i >> 6] |= 1ULL << (i & 63); }
+    void clearBit(ElemIndex i) { words[i >> 6] &= ~(1ULL << (i & 63)); }
+
+    // Number of set bits
+    ElemIndex count() const;
+
+    // Keeps only the bits of members of s / clears the bits of members of s
+    void intersect(const ElemSet &s) { s.andWords(words.data(), words.size()); }
+    void subtract(const ElemSet &s) { s.andNotWords(words.data(), words.size()); }
+
+    ElemSet toElemSet() const { return ElemSet::fromWords(words.constData(), words.size()); }
+
+private:
+    QVector<quint64> words;
+    ElemIndex numBits;
+};
+
+#endif // BITMASK_H
@@ -117,18 +117,27 @@ void CodeViz::processData()
     sourceMaxVal = 0;
     sourceBlocks.clear();
 
+    const long long *sourceUids = dataSet->samples.column(SampleAxes::sourceUid);
+    const long long *lines = dataSet->samples.column(SampleAxes::line);
+    const long long *latencies = dataSet->samples.column(SampleAxes::latency);
+
+    // Source block of each source file UID, looked up on first use
+    QVector<int> sourceIdxByUid(dataSet->sourceNames.size(),-1);
+
     // Get metric values
-    for(Sample s: dataSet->samples)
+    for(ElemIndex elem=0; elem<dataSet->samples.size(); elem++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(s.sampleId))
+        if(dataSet->selectionDefined() && !dataSet->selected(elem))
             continue;
 
-        int sourceIdx = this->getFileID(s.source);
-        sourceBlocks[sourceIdx].val += s.latency;
+        int &sourceIdx = sourceIdxByUid[sourceUids[elem]];
+        if(sourceIdx == -1)
+            sourceIdx = this->getFileID(dataSet->sourceNames.at(sourceUids[elem]));
+        sourceBlocks[sourceIdx].val += latencies[elem];
         sourceMaxVal = std::max(sourceMaxVal,sourceBlocks[sourceIdx].val);
 
-        int lineIdx = this->getLineID(&sourceBlocks[sourceIdx],s.line);
-        sourceBlocks[sourceIdx].lineBlocks[lineIdx].val += s.latency;
+        int lineIdx = this->getLineID(&sourceBlocks[sourceIdx],lines[elem]);
+        sourceBlocks[sourceIdx].lineBlocks[lineIdx].val += latencies[elem];
 
         sourceBlocks[sourceIdx].lineMaxVal = std::max(sourceBlocks[sourceIdx].lineMaxVal,
                                                   sourceBlocks[sourceIdx].lineBlocks[lineIdx].val);
@@ -176,6 +185,7 @@ void CodeViz::selectionChangedSlot()
     {
         processData();
         needsRepaint = true;
+        requestFrame();
     }
 }
 
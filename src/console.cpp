@@ -55,7 +55,15 @@ static QString helpText(
     "           [DIMRANGE dim=vmin:vmax]\n"
     "           [RESOURCE resource=id]\n"
     "    \n"
+    "    group <n>\n"
+    "    group <dst> = <a> {|,&,-} <b>\n"
+    "    undo\n"
+    "    redo\n"
+    "    \n"
     "    inspect\n"
+    "    resources\n"
+    "    vars [N]\n"
+    "    lines [N]\n"
     "    \n"
     "    derivedim <expression>\n"
     "        <expression> is of the form:\n"
@@ -64,6 +72,9 @@ static QString helpText(
     "            + - * /\n"
     "Examples : \n"
     "    select DIMRANGE 4=30:40 5=4:5\n"
+    "    group 2\n"
+    "    group 3 = 1 & 2\n"
+    "    vars 20\n"
     "    \n"
 //    "    select RESOURCE cpu=4 cache=L3\n"
 );
@@ -104,94 +115,88 @@ void console::inspectCommand(QStringList *args)
     Q_UNUSED(args);
 
     // Print out some info about the current selection
-    int numSel = dataSet->numSelected;
-    int numTot = dataSet->numElements;
-
-    log("Selected Samples : ");
-    log(QString::number(numSel));
-    log("Total Samples : ");
-    log(QString::number(numTot));
+    log(selectionSummary(dataSet).toText());
 }
 
 void console::selectCommand(QStringList *args)
 {
-    if(dataSet == NULL)
+    if(args == NULL)
     {
-        log("Unable to select from the void, please load data first");
+        log("Invalid arguments");
         return;
     }
 
-    if(args == NULL || args->size() < 3)
+    QString err = runSelectCommand(dataSet, *args);
+    if(!err.isEmpty())
     {
-        log("Invalid arguments");
+        log(err);
         return;
     }
 
-    QUERY_TYPE qt = getQueryType(args->at(1));
+    emit selectionChangedSig();
+}
 
-    if(qt == QUERY_UNKNOWN)
+void console::groupCommand(QStringList *args)
+{
+    if(dataSet == NULL || dataSet->empty())
     {
-        log("Invalid arguments");
+        log("No data loaded");
         return;
     }
 
-    if(qt == QUERY_DIMRANGE)
+    if(args->size() > 1)
     {
-        struct dimRangeQuery drq = createDimRangeQuery(args);
-        //dataSet->selectByMultiDimRange(drq.dims,drq.mins,drq.maxes);
-        emit selectionChangedSig();
-        return;
+        bool changed;
+        QString err = runGroupCommand(dataSet, *args, &changed);
+        if(!err.isEmpty())
+        {
+            log(err);
+            return;
+        }
+        if(changed)
+            emit selectionChangedSig();
     }
-}
-
-CMD_TYPE console::getCommandType(QString cmd)
-{
-    cmd = cmd.toLower();
-    if(cmd == "help" || cmd == "h")
-        return CMD_HELP;
-    else if(cmd == "select" || cmd == "sel")
-        return CMD_SELECT;
-    else if(cmd == "inspect" || cmd == "ins")
-        return CMD_INSPECT;
-    return CMD_UNKNOWN;
-}
 
-QUERY_TYPE console::getQueryType(QString qtype)
-{
-    qtype = qtype.toLower();
-    if(qtype == "dimrange")
-        return QUERY_DIMRANGE;
-    else if(qtype == "resource")
-        return QUERY_RESOURCE;
-    return QUERY_UNKNOWN;
+    log(groupSummary(dataSet).toText());
 }
 
-dimRange console::createDimRange(QString str)
+void console::historyCommand(CMD_TYPE cmdType)
 {
-    QStringList eqSplit = str.split("=");
-    QStringList rangeStrs = eqSplit[1].split(":");
+    if(dataSet == NULL)
+        return;
 
-    struct dimRange dr;
-    dr.dim = eqSplit[0];
-    dr.min = rangeStrs[0].toDouble();
-    dr.max = rangeStrs[1].toDouble();
+    bool stepped = (cmdType == CMD_UNDO) ? dataSet->undoSelection() : dataSet->redoSelection();
+    if(!stepped)
+    {
+        log("Nothing to "+QString(cmdType == CMD_UNDO ? "undo" : "redo"));
+        return;
+    }
 
-    return dr;
+    emit selectionChangedSig();
 }
 
-struct dimRangeQuery console::createDimRangeQuery(QStringList *args)
+void console::tableCommand(CMD_TYPE cmdType, QStringList *args)
 {
-    struct dimRangeQuery drq;
-
-    for(int i=2; i<args->size(); i++)
+    if(dataSet == NULL || dataSet->empty())
     {
-        struct dimRange dr = createDimRange(args->at(i));
-        drq.dims.push_back(dr.dim);
-        drq.mins.push_back(dr.min);
-        drq.maxes.push_back(dr.max);
+        log("No data loaded");
+        return;
     }
 
-    return drq;
+    switch(cmdType)
+    {
+    case(CMD_RESOURCES):
+        log(resourceSummary(dataSet).toText());
+        break;
+    case(CMD_VARIABLES):
+        log(topVariables(dataSet, topRowsArgument(*args)).toText());
+        break;
+    case(CMD_LINES):
+        log(topLines(dataSet, topRowsArgument(*args)).toText());
+        break;
+    default:
+        break;
+    }
 }
 
 void console::command(int i)
@@ -222,6 +227,18 @@ void console::command(int i)
     case(CMD_INSPECT):
         inspectCommand(&cmdArgs);
         break;
+    case(CMD_RESOURCES):
+    case(CMD_VARIABLES):
+    case(CMD_LINES):
+        tableCommand(cmdType, &cmdArgs);
+        break;
+    case(CMD_GROUP):
+        groupCommand(&cmdArgs);
+        break;
+    case(CMD_UNDO):
+    case(CMD_REDO):
+        historyCommand(cmdType);
+        break;
     default:
         log("Command unrecognized, type 'help' or 'h' for a list of commands");
         break;
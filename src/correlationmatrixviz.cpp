@@ -72,7 +72,7 @@ void CorrelationMatrixViz::mouseReleaseEvent(QMouseEvent *event)
     if(sel.x() == -1)
         return;
 
-    selected = ROWMAJOR_2D(sel.y(),sel.x(),datasets->at(i)->numDimensions);
+    selected = ROWMAJOR_2D(sel.y(),sel.x(),NUM_SAMPLE_AXES);
 
     if(selected != prevSelected)
     {
@@ -100,7 +100,7 @@ bool CorrelationMatrixViz::eventFilter(QObject *obj, QEvent *event)
         if(sel.x() == -1)
             highlighted = -1;
         else
-            highlighted = ROWMAJOR_2D(sel.y(),sel.x(),datasets->at(i)->numDimensions);
+            highlighted = ROWMAJOR_2D(sel.y(),sel.x(),NUM_SAMPLE_AXES);
 
         if(highlighted != prevHighlighted)
         {
@@ -115,6 +115,13 @@ bool CorrelationMatrixViz::eventFilter(QObject *obj, QEvent *event)
 
 void CorrelationMatrixViz::processData()
 {
+    processed = false;
+
+    if(dataSet == NULL || dataSet->empty())
+        return;
+
+    dataSet->calcSelectionStatistics();
+
     processed = true;
 }
 
@@ -123,8 +130,8 @@ QPoint CorrelationMatrixViz::matrixID(QPoint pixel)
     if(!matrixBBox.contains(pixel))
         return QPoint(-1,-1);
 
-    qreal sx = datasets->at(i)->numDimensions*normalize(pixel.x(),matrixBBox.left(),matrixBBox.right());
-    qreal sy = datasets->at(i)->numDimensions*normalize(pixel.y(),matrixBBox.top(),matrixBBox.bottom());
+    qreal sx = NUM_SAMPLE_AXES*normalize(pixel.x(),matrixBBox.left(),matrixBBox.right());
+    qreal sy = NUM_SAMPLE_AXES*normalize(pixel.y(),matrixBBox.top(),matrixBBox.bottom());
 
     return QPoint(floor(sx),floor(sy));
 }
@@ -148,8 +155,8 @@ void CorrelationMatrixViz::drawQtPainter(QPainter *painter)
                        (rect().right()-m-tw) - (rect().left()+lm),
                        (rect().bottom()-m) - (rect().top()+m));
 
-    qreal deltax = matrixBBox.width() / datasets->at(i)->numDimensions;
-    qreal deltay = matrixBBox.height() / datasets->at(i)->numDimensions;
+    qreal deltax = matrixBBox.width() / NUM_SAMPLE_AXES;
+    qreal deltay = matrixBBox.height() / NUM_SAMPLE_AXES;
 
     QPointF o = matrixBBox.topLeft();
 
@@ -174,7 +181,7 @@ void CorrelationMatrixViz::drawQtPainter(QPainter *painter)
 
     painter->setBrush(QBrush(QColor(0,0,0)));
 
-    for(int i=0; i<=datasets->at(i)->numDimensions; i++)
+    for(int i=0; i<=NUM_SAMPLE_AXES; i++)
     {
         painter->drawLine(a,b);
         a += QPointF(deltax,0);
@@ -185,7 +192,7 @@ void CorrelationMatrixViz::drawQtPainter(QPainter *painter)
     a = o;
     b = matrixBBox.topRight() + QPointF(tw,0);
 
-    for(int i=0; i<=datasets->at(i)->numDimensions; i++)
+    for(int i=0; i<=NUM_SAMPLE_AXES; i++)
     {
         painter->drawLine(a,b);
         a += QPointF(0,deltay);
@@ -196,22 +203,22 @@ void CorrelationMatrixViz::drawQtPainter(QPainter *painter)
     painter->setPen(QColor(0,0,0));
     a = matrixBBox.topLeft();
     b = a + QPointF(deltax,deltay);
-    for(int i=0; i<datasets->at(i)->numDimensions; i++)
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
     {
         a = o + QPointF(0,i*deltay);
         b = a + QPointF(deltax,deltay);
-        for(int j=0; j<datasets->at(i)->numDimensions; j++)
+        for(int j=0; j<NUM_SAMPLE_AXES; j++)
         {
             painter->setBrush(
-                        valToColor(datasets->at(i)->selectionCorrelationBtwn(i,j),
+                        valToColor(dataSet->selectionCorrelationBtwn(i,j),
                                    minVal, maxVal, colorBarMin, colorBarMax));
 
-            if(ROWMAJOR_2D(i,j,datasets->at(i)->numDimensions) == selected)
+            if(ROWMAJOR_2D(i,j,NUM_SAMPLE_AXES) == selected)
             {
                 painter->setPen(QPen(Qt::black, 1, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
                 painter->drawRect(QRectF(a+QPointF(2,2),b-QPointF(2,2)));
             }
-            else if(ROWMAJOR_2D(i,j,datasets->at(i)->numDimensions) == highlighted)
+            else if(ROWMAJOR_2D(i,j,NUM_SAMPLE_AXES) == highlighted)
             {
                 painter->setPen(QPen(Qt::yellow, 1, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
                 painter->drawRect(QRectF(a+QPointF(2,2),b-QPointF(2,2)));
@@ -229,17 +236,17 @@ void CorrelationMatrixViz::drawQtPainter(QPainter *painter)
 
     // Draw labels
     painter->setPen(QColor(0,0,0));
-    for(int i=0; i<datasets->at(i)->numDimensions; i++)
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
     {
         painter->drawText(o+QPointF(i*deltax,-2),SampleAxes::SampleAxesNames[i]);
-        // painter->drawText(o+QPointF(i*deltax,-2),datasets->at(i)->meta[i]);
+        // painter->drawText(o+QPointF(i*deltax,-2),dataSet->meta[i]);
     }
 
     QPointF vp = matrixBBox.topRight();
-    for(int i=0; i<datasets->at(i)->numDimensions; i++)
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
     {
         painter->drawText(vp+QPointF(0,10),SampleAxes::SampleAxesNames[i]);
-        // painter->drawText(vp+QPointF(0,10),datasets->at(i)->meta[i]);
+        // painter->drawText(vp+QPointF(0,10),dataSet->meta[i]);
         vp += QPointF(0,deltay);
     }
 }
@@ -262,6 +269,9 @@ void CorrelationMatrixViz::setMax(int v)
 
 void CorrelationMatrixViz::selectionChangedSlot()
 {
-    datasets->at(i)->calcSelectionStatistics();
+    if(!processed)
+        return;
+
+    // DataObject::selectionChanged() has already refreshed the statistics
     repaint();
 }
@@ -42,9 +42,14 @@
 #include <iostream>
 #include <algorithm>
 #include <functional>
+#include <cstring>
 
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QElapsedTimer>
+
+#include "parallel.h"
 
 DataObject::DataObject()
 {
@@ -52,6 +57,9 @@ DataObject::DataObject()
     numElements = 0;
     numSelected = 0;
     numVisible = 0;
+    topoSamplesValid = false;
+    replayingHistory = false;
+    batchingSelection = false;
 
     node = NULL;
 
@@ -76,17 +84,40 @@ int DataObject::loadHardwareTopology(QString filename)
         // allComponents[i]->attrib["sampleSets"] = (void*) new QMap<DataObject*,SampleSet>();
         allComponents[i]->attrib["transactions"] = (void*) new int();
     }
+
+    buildSampleRoutes();
+    componentTable.build(node);
     return err;
 }
 
 int DataObject::loadData(QString filename)
 {
-    int err = parseCSVFile(filename);
+    // Reuse the columnar cache if it matches the CSV file, otherwise
+    // parse the CSV and write a fresh cache for the next load
+    QString cacheFileName = sampleCacheFileName(filename);
+    quint64 fingerprint = fileFingerprint(filename);
+
+    int err = readSampleCache(cacheFileName, fingerprint);
     if(err)
-        return err;
+    {
+        err = parseCSVFile(filename);
+        if(err)
+            return err;
+
+        if(writeSampleCache(cacheFileName, fingerprint))
+            logMessage("Unable to write sample cache "+cacheFileName);
+    }
+
+    bindSamplesToTopology();
+    componentTable.bindSampleSets();
+    this->allocate();
+    topoSamplesValid = false;
 
     calcStatistics();
-    // constructSortedLists();
+
+    // Sorted lists are rebuilt lazily for the new samples
+    for(int dim=0; dim<NUM_SAMPLE_AXES; dim++)
+        std::vector<quint32>().swap(dimSortedLists[dim]);
 
     return 0;
 }
@@ -94,20 +125,24 @@ int DataObject::loadData(QString filename)
 void DataObject::allocate()
 {
     numElements = samples.size();
-    // numDimensions = meta.size();
-    // numElements = vals.size() / numDimensions;
-    //
-    // begin = vals.begin();
-    // end = vals.end();
+    numVisible = numElements;
 
-    // visibility.resize(numElements);
-    // visibility.fill(VISIBLE);
+    visibility.reset(numElements, VISIBLE);
 
     selectionGroup.resize(numElements);
     selectionGroup.fill(0); // all belong to 0 (unselected)
 
-    selectionSets.push_back(ElemSet());
-    selectionSets.push_back(ElemSet());
+    selectionSets.assign(MAX_SELECTION_GROUPS+1, ElemSet());
+    group_comoments.assign(MAX_SELECTION_GROUPS+1, CoMoments());
+    selectedUnion.clear();
+    union_comoments = CoMoments();
+    numSelected = 0;
+
+    pendingStep.clear();
+    undoSteps.clear();
+    redoSteps.clear();
+    batchingSelection = false;
+    batchStartSets.clear();
 }
 
 int DataObject::selected(ElemIndex index)
@@ -117,8 +152,7 @@ int DataObject::selected(ElemIndex index)
 
 bool DataObject::visible(ElemIndex index)
 {
-    return samples[(int)index].visible;
-    // return visibility.at((int)index);
+    return visibility.testBit(index);
 }
 
 bool DataObject::selectionDefined()
@@ -126,26 +160,27 @@ bool DataObject::selectionDefined()
     return numSelected > 0;
 }
 
-void DataObject::selectData(ElemIndex index, int group)
+void DataObject::setActiveGroup(int group)
 {
-    if(visible(index))
-    {
-        selectionGroup[index] = group;
-        selectionSets.at(group).insert(index);
-        numSelected++;
-    }
+    selGroup = std::max(1, std::min(group, MAX_SELECTION_GROUPS));
 }
 
-void DataObject::selectAll(int group)
+void DataObject::selectData(ElemIndex index, int group)
 {
-    selectionGroup.fill(group);
+    group = groupIndex(group);
+    if(!visible(index) || selectionSets.at(group).contains(index))
+        return;
 
-    for(ElemIndex i=0; i<numElements; i++)
-    {
-        selectionSets.at(group).insert(i);
-    }
+    ElemSet elem;
+    elem.insert(index);
+    setGroupSet(group, selectionSets.at(group) | elem);
+}
 
-    numSelected = numElements;
+void DataObject::selectAll(int group)
+{
+    ElemSet all;
+    all.insertRange(0, numElements);
+    setGroupSet(groupIndex(group), all);
 }
 
 void DataObject::deselectAll()
@@ -153,27 +188,61 @@ void DataObject::deselectAll()
     selectionGroup.fill(0);
 
     for(unsigned int i=0; i<selectionSets.size(); i++)
+    {
+        if(recordingHistory() && !selectionSets.at(i).empty())
+        {
+            GroupDelta delta;
+            delta.group = i;
+            std::swap(delta.removed, selectionSets.at(i));
+            pendingStep.push_back(delta);
+        }
+
         selectionSets.at(i).clear();
+        group_comoments.at(i) = CoMoments();
+    }
+    selectedUnion.clear();
+    union_comoments = CoMoments();
 
     numSelected = 0;
 }
 
+void DataObject::clearGroup(int group)
+{
+    setGroupSet(groupIndex(group), ElemSet());
+}
+
 void DataObject::selectAllVisible(int group)
 {
-    ElemIndex elem;
-    for(elem=0; elem<numElements; elem++)
+    group = groupIndex(group);
+    setGroupSet(group, selectionSets.at(group) | visibility.toElemSet());
+}
+
+void DataObject::combineGroups(int dst, int a, int b, group_op op)
+{
+    const ElemSet &setA = selectionSets.at(groupIndex(a));
+    const ElemSet &setB = selectionSets.at(groupIndex(b));
+
+    ElemSet result;
+    switch(op)
     {
-        if(visible(elem))
-            selectData(elem,group);
+    case(GROUP_UNION):
+        result = setA | setB;
+        break;
+    case(GROUP_INTERSECTION):
+        result = setA & setB;
+        break;
+    case(GROUP_DIFFERENCE):
+        result = setA - setB;
+        break;
     }
+    setGroupSet(groupIndex(dst), result);
 }
 
 void DataObject::showData(unsigned int index)
 {
     if(!visible(index))
     {
-        samples[(int)index].visible = VISIBLE;
-        //visibility[index] = VISIBLE;
+        visibility.setBit(index);
         numVisible++;
     }
 }
@@ -182,35 +251,32 @@ void DataObject::hideData(unsigned int index)
 {
     if(visible(index))
     {
-        samples[(int)index].visible = INVISIBLE;
-        //visibility[index] = INVISIBLE;
+        visibility.clearBit(index);
         numVisible--;
     }
 }
 
 void DataObject::showAll()
 {
-    for(Sample s: samples)
-        s.visible = VISIBLE;
-    // visibility.fill(VISIBLE);
+    visibility.fill(VISIBLE);
     numVisible = numElements;
 }
 
 void DataObject::hideAll()
 {
-    for(Sample s: samples)
-        s.visible = INVISIBLE;
-    // visibility.fill(INVISIBLE);
+    visibility.fill(INVISIBLE);
     numVisible = 0;
 }
 
 void DataObject::selectBySourceFileName(QString str, int group)
 {
     ElemSet selSet;
-    for(Sample s: samples)
+    long long uid = sourceNames.find(str);
+    const long long *sourceUids = samples.column(SampleAxes::sourceUid);
+    for(ElemIndex elem=0; uid != -1 && elem<numElements; elem++)
     {
-        if(s.source == str)
-            selSet.insert(s.sampleId);
+        if(sourceUids[elem] == uid)
+            selSet.insert(elem);
     }
     // ElemIndex elem;
     // QVector<qreal>::Iterator p;
@@ -237,10 +303,11 @@ void DataObject::selectBySourceFileName(QString str, int group)
 void DataObject::selectByLineRange(qreal vmin, qreal vmax, int group)
 {
     ElemSet selSet;
-    for(Sample sample : samples)
+    const long long *lines = samples.column(SampleAxes::line);
+    for(ElemIndex elem=0; elem<numElements; elem++)
     {
-        if(sample.line >= vmin && sample.line < vmax)
-            selSet.insert(sample.sampleId);
+        if(lines[elem] >= vmin && lines[elem] < vmax)
+            selSet.insert(elem);
     }
     selectSet(selSet,group);
 }
@@ -289,54 +356,99 @@ void DataObject::selectByLineRange(qreal vmin, qreal vmax, int group)
 
 void DataObject::selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group)
 {
-    //TODO !!!
-    //TODO !!!
-    //TODO !!!
-    //TODO !!!
-    //TODO !!!
+    if(dims.isEmpty())
+        return;
 
-    // ElemSet selSet;
-    // for(int d=0; d<dims.size(); d++)
-    // {
-    //     int dim = dims[d];
-    //     std::vector<indexedValue>::iterator itMin;
-    //     std::vector<indexedValue>::iterator itMax;
-    //
-    //     struct indexedValue ivMinQuery;
-    //     ivMinQuery.val = mins[d];
-    //
-    //     struct indexedValue ivMaxQuery;
-    //     ivMaxQuery.val = maxes[d];
-    //
-    //     if(ivMinQuery.val <= this->minimumValues[dim])
-    //     {
-    //         itMin = dimSortedLists.at(dim).begin();
-    //     }
-    //     else
-    //     {
-    //         itMin = std::find_if(dimSortedLists.at(dim).begin(),
-    //                              dimSortedLists.at(dim).end(),
-    //                              indexedValueLtFunctor(ivMinQuery));
-    //     }
-    //
-    //     if(ivMaxQuery.val >= this->maximumValues[dim])
-    //     {
-    //         itMax = dimSortedLists.at(dim).end();
-    //     }
-    //     else
-    //     {
-    //         itMax = std::find_if(dimSortedLists.at(dim).begin(),
-    //                              dimSortedLists.at(dim).end(),
-    //                              indexedValueLtFunctor(ivMaxQuery));
-    //     }
-    //
-    //     for(/*itMin*/; itMin != itMax; itMin++)
-    //     {
-    //         selSet.insert(itMin->idx);
-    //     }
-    // }
-    //
-    // selectSet(selSet,group);
+    selectSet(multiDimRangeSet(dims, mins, maxes), group);
+}
+
+// Samples within every axis range, without touching the selection
+ElemSet DataObject::multiDimRangeSet(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes)
+{
+    if(dims.isEmpty())
+        return ElemSet();
+
+    ElemIndex numWords = (numElements+63)/64;
+    std::vector<std::vector<quint64> > dimBits(dims.size());
+
+    for(int d=0; d<dims.size(); d++)
+    {
+        if(dimSortedLists[dims[d]].size() != numElements)
+            constructSortedList(dims[d]);
+    }
+
+    // Each axis range is a contiguous run of its sorted list, found with
+    // two binary searches and scattered into a dense bitmap
+    parallelChunks(dims.size(), dims.size(), [&](int, long long begin, long long end)
+    {
+        for(long long d=begin; d<end; d++)
+        {
+            const std::vector<quint32> &sorted = dimSortedLists[dims[d]];
+            const long long *vals = samples.column(dims[d]);
+            qreal vmin = mins[d];
+            qreal vmax = maxes[d];
+
+            std::vector<quint32>::const_iterator itMin =
+                    std::lower_bound(sorted.begin(), sorted.end(), vmin,
+                                     [vals](quint32 elem, qreal v) { return vals[elem] < v; });
+            std::vector<quint32>::const_iterator itMax =
+                    std::upper_bound(itMin, sorted.end(), vmax,
+                                     [vals](qreal v, quint32 elem) { return v < vals[elem]; });
+
+            std::vector<quint64> &bits = dimBits[d];
+            bits.assign(numWords, 0);
+            for(/*itMin*/; itMin != itMax; itMin++)
+                bits[*itMin >> 6] |= 1ULL << (*itMin & 63);
+        }
+    });
+
+    // Intersect the axes a word at a time
+    std::vector<quint64> &selBits = dimBits[0];
+    parallelChunks(numWords, [&](int, long long begin, long long end)
+    {
+        for(int d=1; d<dims.size(); d++)
+            for(long long w=begin; w<end; w++)
+                selBits[w] &= dimBits[d][w];
+    });
+
+    return ElemSet::fromWords(selBits.data(), numWords);
+}
+
+// Sorts the row indices of one axis by value (ties in row order). Lists
+// are built on first use since brushing typically touches a few axes.
+void DataObject::constructSortedList(int dim)
+{
+    std::vector<quint32> &sorted = dimSortedLists[dim];
+    const long long *vals = samples.column(dim);
+
+    sorted.resize(numElements);
+    for(ElemIndex elem=0; elem<numElements; elem++)
+        sorted[elem] = elem;
+
+    auto less = [vals](quint32 a, quint32 b)
+    {
+        return vals[a] < vals[b] || (vals[a] == vals[b] && a < b);
+    };
+
+    // Sort one run per core, then merge the runs pairwise
+    int numRuns = std::max(1, (int)std::min<ElemIndex>(numWorkerThreads(), numElements));
+    std::vector<ElemIndex> bounds(numRuns+1, numElements);
+    parallelChunks(numElements, numRuns, [&](int run, long long begin, long long end)
+    {
+        bounds[run] = begin;
+        std::sort(sorted.begin()+begin, sorted.begin()+end, less);
+    });
+
+    for(int width=1; width<numRuns; width*=2)
+    {
+        for(int run=0; run+width<numRuns; run+=2*width)
+        {
+            std::inplace_merge(sorted.begin()+bounds[run],
+                               sorted.begin()+bounds[run+width],
+                               sorted.begin()+bounds[std::min(run+2*width,numRuns)],
+                               less);
+        }
+    }
 }
 
 void DataObject::selectByVarName(QString str, int group)
@@ -351,10 +463,12 @@ void DataObject::selectByVarName(QString str, int group)
     //         selSet.insert(elem);
     // }
 
-    for(Sample sample: samples)
+    long long uid = variableNames.find(str);
+    const long long *variableUids = samples.column(SampleAxes::variableUid);
+    for(ElemIndex elem=0; uid != -1 && elem<numElements; elem++)
     {
-        if(sample.variable == str)
-            selSet.insert(sample.sampleId);
+        if(variableUids[elem] == uid)
+            selSet.insert(elem);
     }
     selectSet(selSet,group);
 }
@@ -365,7 +479,7 @@ void DataObject::selectByResource(Component *c, int group)
     vector<DataPath*> dp_vec;
     c->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, SYS_SAGE_DATAPATH_INCOMING | SYS_SAGE_DATAPATH_OUTGOING);
     for(DataPath* dp : dp_vec) {
-        resource_samples.insert(((SampleSet*)dp->attrib["sample_set"])->totSamples.begin(), ((SampleSet*)dp->attrib["sample_set"])->totSamples.end());
+        resource_samples |= ((SampleSet*)dp->attrib["sample_set"])->totSamples;
     }
     selectSet(resource_samples, group);
     //selectSet( (*((QMap<DataObject*,SampleSet>*)c->attrib["sampleSets"]))[this].totSamples, group);
@@ -374,50 +488,32 @@ void DataObject::selectByResource(Component *c, int group)
 
 void DataObject::hideSelected()
 {
-    ElemIndex elem;
-    for(elem=0; elem<numElements; elem++)
-    {
-        if(selected(elem))
-            hideData(elem);
-    }
+    visibility.subtract(selectedSet());
+    numVisible = visibility.count();
 }
 
 void DataObject::hideUnselected()
 {
-    ElemIndex elem;
-    for(elem=0; elem<numElements; elem++)
-    {
-        if(!selected(elem) && visible(elem))
-            hideData(elem);
-    }
+    visibility.intersect(selectedSet());
+    numVisible = visibility.count();
 }
 
-void DataObject::selectSet(ElemSet &s, int group)
+void DataObject::selectSet(const ElemSet &s, int group)
 {
-    ElemSet *newSel = NULL;
+    group = groupIndex(group);
+
+    ElemSet newSel;
     if(selMode == MODE_NEW)
     {
-        newSel = &s;
+        newSel = s;
     }
     else if(selMode == MODE_APPEND)
     {
-        newSel = new ElemSet();
-        std::set_union(selectionSets.at(group).begin(),
-                       selectionSets.at(group).end(),
-                       s.begin(),
-                       s.end(),
-                       std::inserter(*newSel,
-                                     newSel->begin()));
+        newSel = selectionSets.at(group) | s;
     }
     else if(selMode == MODE_FILTER)
     {
-        newSel = new ElemSet();
-        std::set_intersection(selectionSets.at(group).begin(),
-                              selectionSets.at(group).end(),
-                              s.begin(),
-                              s.end(),
-                              std::inserter(*newSel,
-                                            newSel->begin()));
+        newSel = selectionSets.at(group) & s;
     }
     else
     {
@@ -425,69 +521,316 @@ void DataObject::selectSet(ElemSet &s, int group)
         return;
     }
 
-    // Reprocess groups
-    selectionSets.at(group).clear();
-    selectionGroup.fill(0);
+    // Only visible samples can be selected
+    if(numVisible < numElements)
+        newSel &= visibility.toElemSet();
+
+    setGroupSet(group, newSel);
+}
 
-    for(ElemSet::iterator it = newSel->begin();
-        it != newSel->end();
-        it++)
+// Replaces the members of a group. Only the samples that changed are
+// touched: their group labels, the union of all groups and the running
+// statistics all move by the delta.
+void DataObject::setGroupSet(int group, ElemSet newSel)
+{
+    ElemSet &sel = selectionSets.at(group);
+    ElemSet added = newSel - sel;
+    ElemSet removed = sel - newSel;
+    if(added.empty() && removed.empty())
+        return;
+
+    std::swap(sel, newSel);
+    updateMoments(group_comoments.at(group), sel, added, removed);
+
+    if(recordingHistory())
     {
-        selectData(*it,group);
+        GroupDelta delta;
+        delta.group = group;
+        delta.added = added;
+        delta.removed = removed;
+        pendingStep.push_back(delta);
     }
+
+    // Samples entering or leaving every group change the union
+    ElemSet unionAdded;
+    ElemSet unionRemoved;
+    added.forEach([&](ElemIndex elem)
+    {
+        quint8 &label = selectionGroup[elem];
+        if(label == 0)
+            unionAdded.insert(elem);
+        if(label == 0 || label > group)
+            label = group;
+    });
+    removed.forEach([&](ElemIndex elem)
+    {
+        quint8 &label = selectionGroup[elem];
+        if(label == group)
+        {
+            label = lowestGroup(elem);
+            if(label == 0)
+                unionRemoved.insert(elem);
+        }
+    });
+
+    selectedUnion |= unionAdded;
+    selectedUnion -= unionRemoved;
+    updateMoments(union_comoments, selectedUnion, unionAdded, unionRemoved);
+
+    numSelected = selectedUnion.size();
+}
+
+void DataObject::commitSelectionStep()
+{
+    if(pendingStep.empty() || batchingSelection)
+        return;
+
+    undoSteps.push_back(SelectionStep());
+    std::swap(undoSteps.back(), pendingStep);
+    if(undoSteps.size() > SELECTION_HISTORY_STEPS)
+        undoSteps.pop_front();
+
+    // A new change ends the redo branch
+    redoSteps.clear();
+}
+
+void DataObject::beginSelectionBatch()
+{
+    if(batchingSelection)
+        return;
+
+    commitSelectionStep();
+    batchStartSets = selectionSets;
+    batchingSelection = true;
+}
+
+// Records only the net change of each group since the batch began
+void DataObject::endSelectionBatch()
+{
+    if(!batchingSelection)
+        return;
+
+    batchingSelection = false;
+    for(unsigned int i=0; i<selectionSets.size(); i++)
+    {
+        GroupDelta delta;
+        delta.group = i;
+        delta.added = selectionSets.at(i) - batchStartSets.at(i);
+        delta.removed = batchStartSets.at(i) - selectionSets.at(i);
+        if(!delta.added.empty() || !delta.removed.empty())
+            pendingStep.push_back(delta);
+    }
+    batchStartSets.clear();
+
+    commitSelectionStep();
+}
+
+// Applies a step's deltas in order, or reverts them in reverse order
+void DataObject::replaySelectionStep(const SelectionStep &step, bool forward)
+{
+    replayingHistory = true;
+    for(size_t i=0; i<step.size(); i++)
+    {
+        const GroupDelta &delta = forward ? step[i] : step[step.size()-1-i];
+        const ElemSet &added = forward ? delta.added : delta.removed;
+        const ElemSet &removed = forward ? delta.removed : delta.added;
+
+        setGroupSet(delta.group, (selectionSets.at(delta.group) - removed) | added);
+    }
+    replayingHistory = false;
+}
+
+bool DataObject::undoSelection()
+{
+    if(batchingSelection)
+        return false;
+
+    commitSelectionStep();
+    if(undoSteps.empty())
+        return false;
+
+    replaySelectionStep(undoSteps.back(), false);
+    redoSteps.push_back(SelectionStep());
+    std::swap(redoSteps.back(), undoSteps.back());
+    undoSteps.pop_back();
+    return true;
+}
+
+bool DataObject::redoSelection()
+{
+    if(batchingSelection || redoSteps.empty())
+        return false;
+
+    replaySelectionStep(redoSteps.back(), true);
+    undoSteps.push_back(SelectionStep());
+    std::swap(undoSteps.back(), redoSteps.back());
+    redoSteps.pop_back();
+    return true;
+}
+
+int DataObject::lowestGroup(ElemIndex elem)
+{
+    for(unsigned int g=1; g<selectionSets.size(); g++)
+    {
+        if(selectionSets.at(g).contains(elem))
+            return g;
+    }
+    return 0;
+}
+
+// Moves running co-moments of a set by its delta. Small deltas update in
+// place; when the delta outweighs the new set a fresh pass is cheaper and
+// also clears accumulated rounding error.
+void DataObject::updateMoments(CoMoments &moments, const ElemSet &set, const ElemSet &added, const ElemSet &removed)
+{
+    if(set.size() == numElements)
+        moments = sample_comoments;
+    else if(added.size() + removed.size() < set.size())
+        updateCoMoments(samples, added, removed, moments);
+    else
+        calcCoMoments(samples, &set, moments);
+}
+
+ElemSet DataObject::topoSelection()
+{
+    if(!selectionDefined())
+    {
+        ElemSet all;
+        all.insertRange(0, numElements);
+        return all;
+    }
+
+    return selectedUnion;
+}
+
+void DataObject::updateTopoSamples()
+{
+    ElemSet selectedSet = topoSelection();
+    if(!topoSamplesValid)
+    {
+        collectTopoSamples();
+    }
+    else
+    {
+        ElemSet added = selectedSet - topoSelected;
+        ElemSet removed = topoSelected - selectedSet;
+
+        // Large changes are cheaper to recollect from scratch
+        if(added.size() + removed.size() > numElements/4)
+            collectTopoSamples();
+        else
+            applySelectionDelta(added, removed);
+    }
+
+    componentTable.refresh();
+}
+
+void DataObject::addTopoSample(ElemIndex elem, int sign)
+{
+    SampleRoute *route = sampleRoute(samples.value(elem, SampleAxes::cpu),
+                                     samples.value(elem, SampleAxes::dataSrc));
+    if(route == NULL || route->dataPath == NULL)
+        return;
+
+    DataPath *dp = route->dataPath;
+    SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
+    if(sign > 0)
+        ss->selSamples.insert(elem);
+    else
+        ss->selSamples.erase(elem);
+    ss->selCycles += sign * samples.value(elem, SampleAxes::latency);
+
+    // Same path as the transaction count in collectTopoSamples
+    Component* parent = route->thread;
+    do {
+        *(int*)parent->attrib["transactions"] += sign;
+        parent = parent->GetParent();
+    } while(parent != dp->GetSource() && parent != NULL && parent->GetComponentType() != SYS_SAGE_COMPONENT_CHIP);
+}
+
+void DataObject::applySelectionDelta(const ElemSet &added, const ElemSet &removed)
+{
+    removed.forEach([&](ElemIndex elem) { addTopoSample(elem, -1); });
+    added.forEach([&](ElemIndex elem) { addTopoSample(elem, 1); });
+
+    topoSelected -= removed;
+    topoSelected |= added;
 }
 
 void DataObject::collectTopoSamples()
 {
+    const long long *latencies = samples.column(SampleAxes::latency);
+
+    ElemSet selectedSet = topoSelection();
+
     vector<Component*> allComponents;
+    vector<Component*> threads;
     node->GetSubtreeNodeList(&allComponents);
     for(Component* c : allComponents)
     {
         *(int*)c->attrib["transactions"] = 0;
-        //count incoming DP on a thread (all DPs point to a thread)
         if(c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD)
+            threads.push_back(c);
+    }
+
+    // Every DataPath points to exactly one thread, so the threads can be
+    // filtered independently; transactions are summed per worker and
+    // merged afterwards
+    int numWorkers = std::max(1, (int)std::min<size_t>(numWorkerThreads(), threads.size()));
+    std::vector<QHash<Component*,int> > workerTransactions(numWorkers);
+    std::vector<int> workerEmptyThreads(numWorkers, 0);
+    parallelChunks(threads.size(), numWorkers, [&](int worker, long long begin, long long end)
+    {
+        QHash<Component*,int> &transactions = workerTransactions[worker];
+        for(long long t=begin; t<end; t++)
         {
+            Component *c = threads[t];
+
+            //count incoming DP on a thread (all DPs point to a thread)
             vector<DataPath*> dp_in_vec;
             c->GetAllDpByType(&dp_in_vec, SYS_SAGE_MITOS_SAMPLE, SYS_SAGE_DATAPATH_INCOMING);
             if(dp_in_vec.empty())
             {
-                qDebug( "No samples on HW thread %d", c->GetId());
+                workerEmptyThreads[worker]++;
                 continue;
             }
             for(DataPath* dp_in : dp_in_vec)
             {
                 SampleSet *ss = (SampleSet*)dp_in->attrib["sample_set"];
-                ss->selSamples.clear();
-                ss->selCycles = 0;
+                ss->selSamples = ss->totSamples & selectedSet;
 
-                for(ElemIndex elemid : ss->totSamples)
+                ss->selCycles = 0;
+                ss->selSamples.forEach([&](ElemIndex elemid)
                 {
-                    if(!selectionDefined() || selected(elemid))
-                    {
-                        ss->selSamples.insert(elemid);
-                        ss->selCycles += samples[elemid].latency;
-                    }
-                }
-            }
-        }
-    }
-    for(Component* c : allComponents)
-    {
-        if(c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD)
-        {
-            vector<DataPath*> dp_in_vec;
-            c->GetAllDpByType(&dp_in_vec, SYS_SAGE_MITOS_SAMPLE, SYS_SAGE_DATAPATH_INCOMING);
-            for(DataPath* dp_in : dp_in_vec){
+                    ss->selCycles += latencies[elemid];
+                });
+
                 //add the number of samples to this thread and then to all parent nodes until the source
+                int numSel = ss->selSamples.size();
                 Component* parent = c;
                 do {
-                    *(int*)parent->attrib["transactions"] += ((SampleSet*)dp_in->attrib["sample_set"])->selSamples.size();
+                    transactions[parent] += numSel;
                     parent = parent->GetParent();
                 } while(parent != dp_in->GetSource() && parent != NULL && parent->GetComponentType() != SYS_SAGE_COMPONENT_CHIP);
             }
         }
+    });
+
+    for(const QHash<Component*,int> &transactions : workerTransactions)
+    {
+        for(QHash<Component*,int>::const_iterator it = transactions.constBegin(); it != transactions.constEnd(); it++)
+            *(int*)it.key()->attrib["transactions"] += it.value();
     }
 
+    int emptyThreads = 0;
+    for(int count : workerEmptyThreads)
+        emptyThreads += count;
+    if(emptyThreads > 0)
+        qDebug("No samples on %d of %d HW threads", emptyThreads, (int)threads.size());
+
+    topoSelected = selectedSet;
+    topoSamplesValid = true;
+
     // // Reset info
     // vector<Component*> allComponents;
     // cpu->GetSubtreeNodeList(&allComponents);
@@ -596,208 +939,608 @@ void DataObject::collectTopoSamples()
     // qDebug( "collectTopoSamples3");
 }
 
-int DataObject::DecodeDataSource(QString data_src_str)
-{ qDebug( "dataObject 22" );
-    if(data_src_str == "L1")
+int DataObject::DecodeDataSource(QLatin1String data_src_str)
+{
+    if(data_src_str == QLatin1String("L1"))
         return 1;
-    else if(data_src_str == "LFB")
+    else if(data_src_str == QLatin1String("LFB"))
         return 1;
-    else if(data_src_str == "L2")
+    else if(data_src_str == QLatin1String("L2"))
         return 2;
-    else if(data_src_str == "L3")
+    else if(data_src_str == QLatin1String("L3"))
         return 3;
-    else if(data_src_str == "Local RAM")
+    else if(data_src_str == QLatin1String("Local RAM"))
         return 4;
-    else if(data_src_str == "Remote RAM 1 Hop")
+    else if(data_src_str == QLatin1String("Remote RAM 1 Hop"))
         return 4;
-    else if(data_src_str == "Remote RAM 2 Hops")
+    else if(data_src_str == QLatin1String("Remote RAM 2 Hops"))
         return 4;
-    else if(data_src_str == "Remote Cache 1 Hops")
+    else if(data_src_str == QLatin1String("Remote Cache 1 Hops"))
         return 3;
-    else if(data_src_str == "Remote Cache 2 Hops")
+    else if(data_src_str == QLatin1String("Remote Cache 2 Hops"))
         return 3;
-    else if(data_src_str == "I/O Memory")
+    else if(data_src_str == QLatin1String("I/O Memory"))
         return 4;
-    else if(data_src_str == "Uncached Memory")
+    else if(data_src_str == QLatin1String("Uncached Memory"))
         return 4;
     return -1;
 }
 
 
+// Column positions of the sample attributes, resolved once from the header
+struct CSVColumns
+{
+    int source;
+    int line;
+    int instruction;
+    int bytes;
+    int ip;
+    int variable;
+    int buffer_size;
+    int dims;
+    int xidx;
+    int yidx;
+    int zidx;
+    int pid;
+    int tid;
+    int time;
+    int addr;
+    int cpu;
+    int latency;
+    int level;
+    int data_src;
+};
+
+static CSVColumns resolveCSVColumns(const QStringList &header)
+{
+    CSVColumns cols;
+    cols.source = header.indexOf("source");
+    cols.line = header.indexOf("line");
+    cols.instruction = header.indexOf("instruction");
+    cols.bytes = header.indexOf("bytes");
+    cols.ip = header.indexOf("ip");
+    cols.variable = header.indexOf("variable");
+    cols.buffer_size = header.indexOf("buffer_size");
+    cols.dims = header.indexOf("dims");
+    cols.xidx = header.indexOf("xidx");
+    cols.yidx = header.indexOf("yidx");
+    cols.zidx = header.indexOf("zidx");
+    cols.pid = header.indexOf("pid");
+    cols.tid = header.indexOf("tid");
+    cols.time = header.indexOf("time");
+    cols.addr = header.indexOf("addr");
+    cols.cpu = header.indexOf("cpu");
+    cols.latency = header.indexOf("latency");
+    cols.level = header.indexOf("level");
+    cols.data_src = header.indexOf("data_src");
+    return cols;
+}
+
+static inline long long fieldLongLong(const ByteRange *fields, int col)
+{
+    return (col < 0) ? 0 : parseLongLong(fields[col].begin, fields[col].end);
+}
+
+static inline int fieldInt(const ByteRange *fields, int col)
+{
+    return (col < 0) ? 0 : parseInt(fields[col].begin, fields[col].end);
+}
+
+static inline quint32 fieldID(StringInterner &names, const ByteRange *fields, int col)
+{
+    return (col < 0) ? names.intern(NULL, NULL) : names.intern(fields[col].begin, fields[col].end);
+}
+
+// Newline-aligned byte range of the samples file and the samples parsed from it
+struct CSVChunk
+{
+    CSVChunk() : begin(0), end(0), failed(false) {}
+
+    qint64 begin;
+    qint64 end;
+    bool failed;
+    SampleTable samples;
+
+    // Chunk-local name IDs, remapped to the DataObject's when merging
+    StringInterner sources;
+    StringInterner instructions;
+    StringInterner variables;
+};
+
+// Re-intern the chunk-local names of one UID column into the shared interner
+static void remapChunkIDs(long long *uids, ElemIndex n, const StringInterner &local, StringInterner &shared)
+{
+    QVector<quint32> remap(local.size());
+    for(int i=0; i<local.size(); i++)
+        remap[i] = shared.intern(local.at(i));
+    for(ElemIndex i=0; i<n; i++)
+        uids[i] = remap[uids[i]];
+}
+
 int DataObject::parseCSVFile(QString dataFileName)
 {
-    // Open the file
+    QElapsedTimer ingestTimer;
+    ingestTimer.start();
+
+    // Open and map the file
     QFile dataFile(dataFileName);
 
-    if (!dataFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!dataFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    qint64 dataEnd = dataFile.size();
+    if(dataEnd == 0)
         return -1;
 
-    // Create text stream
-    QTextStream dataStream(&dataFile);
-    QString line;
-    QStringList lineValues;
-    qint64 elemid = 0;
+    const char *data = (const char*)dataFile.map(0, dataEnd);
+    if(data == NULL)
+    {
+        std::cerr << "ERROR: unable to map " << dataFileName.toStdString() << std::endl;
+        return -1;
+    }
+    const char *dataStop = data + dataEnd;
 
     // Get metadata from first line
-    line = dataStream.readLine();
-    // this->meta = line.split(',');
-    // this->numDimensions = this->meta.size();
-    //
-    // sourceDim = this->meta.indexOf("source");
-    // lineDim = this->meta.indexOf("line");
-    // variableDim = this->meta.indexOf("variable");
-    // dataSourceDim = this->meta.indexOf("data_src");
-    // indexDim = this->meta.indexOf("index");
-    // latencyDim = this->meta.indexOf("latency");
-    // nodeDim = this->meta.indexOf("node");
-    // cpuDim = this->meta.indexOf("cpu");
-    // xDim = this->meta.indexOf("xidx");
-    // yDim = this->meta.indexOf("yidx");
-    // zDim = this->meta.indexOf("zidx");
-
-    QVector<QString> varVec;
-    QVector<QString> sourceVec;
-    QVector<QString> instrVec;
+    const char *headerEnd = findNewline(data, dataStop);
+    QString line = QString::fromUtf8(data, headerEnd-data).trimmed();
     QStringList header = line.split(',');
-    ElemIndex numHeaderDimensions = header.size();
+    int numHeaderDimensions = header.size();
+    CSVColumns cols = resolveCSVColumns(header);
 
-    // Get data
-    while(!dataStream.atEnd())
+    qint64 dataBegin = std::min(headerEnd+1, dataStop) - data;
+
+    // Parse newline-aligned chunks of the mapped file on all cores
+    std::vector<CSVChunk> chunks(numWorkerThreads());
+    parallelChunks(dataEnd-dataBegin, chunks.size(), [&](int c, long long lo, long long hi)
     {
-        line = dataStream.readLine();
-        lineValues = line.split(',');
+        CSVChunk &chunk = chunks[c];
+        chunk.begin = dataBegin + lo;
+        chunk.end = dataBegin + hi;
+
+        std::vector<ByteRange> fields(numHeaderDimensions);
+
+        // A chunk owns the lines starting inside [begin,end), so skip
+        // the rest of a line straddling begin (or just its newline)
+        const char *p = findNewline(data + chunk.begin - 1, dataStop);
+        const char *chunkStop = data + chunk.end;
+
+        while(p < dataStop && ++p < chunkStop)
+        {
+            const char *rowBegin = p;
+            p = findNewline(rowBegin, dataStop);
+
+            const char *rowEnd = p;
+            while(rowEnd > rowBegin && *(rowEnd-1) == '\r')
+                rowEnd--;
+            if(rowEnd == rowBegin)
+                continue;
+
+            int numFields = tokenizeCSVLine(rowBegin, rowEnd, fields.data(), numHeaderDimensions);
+            if(numFields != numHeaderDimensions)
+            {
+                chunk.failed = true;
+                return;
+            }
+
+            const ByteRange *f = fields.data();
+
+            // Everything is parsed straight from the mapped bytes, names
+            // are interned per chunk (ids are assigned when merging)
+            long long row[NUM_SAMPLE_AXES];
+            row[SampleAxes::sampleId] = 0;
+            row[SampleAxes::sourceUid] = fieldID(chunk.sources,f,cols.source);
+            row[SampleAxes::line] = fieldLongLong(f,cols.line);
+            row[SampleAxes::instructionUid] = fieldID(chunk.instructions,f,cols.instruction);
+            row[SampleAxes::bytes] = fieldLongLong(f,cols.bytes);
+            row[SampleAxes::ip] = fieldLongLong(f,cols.ip);
+            row[SampleAxes::variableUid] = fieldID(chunk.variables,f,cols.variable);
+            row[SampleAxes::buffer_size] = fieldLongLong(f,cols.buffer_size);
+            row[SampleAxes::dims] = fieldInt(f,cols.dims);
+            row[SampleAxes::xidx] = fieldInt(f,cols.xidx);
+            row[SampleAxes::yidx] = fieldInt(f,cols.yidx);
+            row[SampleAxes::zidx] = fieldInt(f,cols.zidx);
+            row[SampleAxes::pid] = fieldInt(f,cols.pid);
+            row[SampleAxes::tid] = fieldInt(f,cols.tid);
+            row[SampleAxes::time] = fieldLongLong(f,cols.time);
+            row[SampleAxes::addr] = fieldLongLong(f,cols.addr);
+            row[SampleAxes::cpu] = fieldInt(f,cols.cpu);
+            row[SampleAxes::latency] = fieldLongLong(f,cols.latency);
+            if(cols.level != -1)
+                row[SampleAxes::dataSrc] = DecodeDataSource(QLatin1String(f[cols.level].begin, f[cols.level].size()));
+            else
+                row[SampleAxes::dataSrc] = dseDepth(fieldInt(f,cols.data_src));
+            chunk.samples.append(row);
+        }
+    });
+
+    dataFile.unmap((uchar*)data);
+    dataFile.close();
 
-        if(lineValues.size() != numHeaderDimensions)
+    // Merge chunks in file order
+    qint64 numSamples = 0;
+    for(unsigned int c=0; c<chunks.size(); c++)
+    {
+        if(chunks[c].failed)
         {
             std::cerr << "ERROR: element dimensions do not match headerdata!" << std::endl;
-            std::cerr << "At element " << elemid << std::endl;
+            std::cerr << "At element " << numSamples+chunks[c].samples.size() << std::endl;
             return -1;
         }
+        numSamples += chunks[c].samples.size();
+    }
 
-        Sample s;
-        s.sampleId = elemid;
-        s.sourceUid = createUniqueID(sourceVec,lineValues[header.indexOf("source")]);
-        s.source = lineValues[header.indexOf("source")];
-        s.line = lineValues[header.indexOf("line")].toLongLong();
-        s.instructionUid = createUniqueID(instrVec,lineValues[header.indexOf("instruction")]);
-        s.instruction = lineValues[header.indexOf("instruction")];
-        s.bytes = lineValues[header.indexOf("bytes")].toLongLong();
-        s.ip = lineValues[header.indexOf("ip")].toLongLong();
-        s.variableUid = createUniqueID(varVec,lineValues[header.indexOf("variable")]);
-        s.variable = lineValues[header.indexOf("variable")];
-        s.buffer_size = lineValues[header.indexOf("buffer_size")].toLongLong();
-        s.dims = lineValues[header.indexOf("dims")].toInt();
-        s.xidx = lineValues[header.indexOf("xidx")].toInt();
-        s.yidx = lineValues[header.indexOf("yidx")].toInt();
-        s.zidx = lineValues[header.indexOf("zidx")].toInt();
-        s.pid = lineValues[header.indexOf("pid")].toInt();
-        s.tid = lineValues[header.indexOf("tid")].toInt();
-        s.time = lineValues[header.indexOf("time")].toLongLong();
-        s.addr = lineValues[header.indexOf("addr")].toLongLong();
-        s.cpu = lineValues[header.indexOf("cpu")].toInt();
-        s.latency = lineValues[header.indexOf("latency")].toLongLong();
-        //s.data_src = dseDepth(lineValues[header.indexOf("data_src")].toInt(NULL,10));
-        s.data_src = DecodeDataSource(lineValues[header.indexOf("level")]);
-        s.visible = VISIBLE;
-        samples.push_back(s);
+    // Names of earlier data sets would otherwise end up in every
+    // later cache
+    clearSampleNames();
+    samples.clear();
+    samples.resize(numSamples);
 
-        //add samples as DataPath pointers
-        Component * compTarget = node->FindSubcomponentById(s.cpu, SYS_SAGE_COMPONENT_THREAD);
-        Component * compSrc = compTarget;//connect with the right memory/cache
-        while(compSrc != NULL && s.data_src != -1){
-            compSrc = compSrc->GetParent();
-            if(s.data_src == 1
-                && compSrc->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
-                && ((Cache*)compSrc)->GetCacheLevel()==1) break;//L1
-            else if(s.data_src == 2
-                && compSrc->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
-                && ((Cache*)compSrc)->GetCacheLevel()==2) break;//L2
-            else if(s.data_src == 3
-                && compSrc->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
-                && ((Cache*)compSrc)->GetCacheLevel()==3) break;//L3
-            else if(s.data_src == 4
-                && (compSrc->GetComponentType() == SYS_SAGE_COMPONENT_NUMA
-                || compSrc->GetComponentType() == SYS_SAGE_COMPONENT_CHIP)) break;//main memory
+    ElemIndex offset = 0;
+    for(unsigned int c=0; c<chunks.size(); c++)
+    {
+        CSVChunk &chunk = chunks[c];
+        ElemIndex chunkSize = chunk.samples.size();
+
+        for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+        {
+            const long long *src = chunk.samples.column(axis);
+            std::copy(src, src+chunkSize, samples.column(axis)+offset);
         }
-        if(compSrc == NULL || compTarget == NULL)
+
+        long long *sampleIds = samples.column(SampleAxes::sampleId) + offset;
+        for(ElemIndex i=0; i<chunkSize; i++)
+            sampleIds[i] = offset+i;
+
+        remapChunkIDs(samples.column(SampleAxes::sourceUid)+offset, chunkSize, chunk.sources, sourceNames);
+        remapChunkIDs(samples.column(SampleAxes::instructionUid)+offset, chunkSize, chunk.instructions, instructionNames);
+        remapChunkIDs(samples.column(SampleAxes::variableUid)+offset, chunkSize, chunk.variables, variableNames);
+
+        offset += chunkSize;
+        chunk = CSVChunk();
+    }
+
+    qint64 elapsed = std::max(ingestTimer.elapsed(),1LL);
+    qreal megabytes = (qreal)dataEnd / (1024.0*1024.0);
+    logMessage(QString("Loaded %1 samples (%2 MB) in %3 s : %4 rows/s, %5 MB/s")
+               .arg(numSamples)
+               .arg(megabytes,0,'f',1)
+               .arg(elapsed/1000.0,0,'f',2)
+               .arg(numSamples*1000/elapsed)
+               .arg(megabytes*1000.0/elapsed,0,'f',1));
+
+    return 0;
+}
+
+// Binary columnar sample cache (.maxc) layout:
+//   SampleCacheHeader
+//   numColumns arrays of numSamples qint64 values, in SampleAxes order
+//   numDictionaries string tables (source, instruction, variable), each
+//   a quint32 count followed by (quint32 length, UTF-8 bytes) entries
+#define SAMPLE_CACHE_MAGIC 0x4358414d // "MAXC"
+#define SAMPLE_CACHE_VERSION 1
+#define SAMPLE_CACHE_DICTIONARIES 3
+
+struct SampleCacheHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint64 fingerprint;
+    quint64 numSamples;
+    quint32 numColumns;
+    quint32 numDictionaries;
+};
+
+QString DataObject::sampleCacheFileName(QString dataFileName)
+{
+    QFileInfo info(dataFileName);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".maxc";
+}
+
+// Interns the cached names into a dictionary of their own and records
+// the ID each cached UID maps to
+static bool readCacheDictionary(const uchar *&p, const uchar *end, StringInterner &names, QVector<quint32> &remap)
+{
+    quint32 count;
+    if(end-p < (qint64)sizeof(count))
+        return false;
+    memcpy(&count, p, sizeof(count));
+    p += sizeof(count);
+
+    remap.clear();
+    for(quint32 i=0; i<count; i++)
+    {
+        quint32 len;
+        if(end-p < (qint64)sizeof(len))
+            return false;
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if(end-p < (qint64)len)
+            return false;
+        remap.push_back(names.intern((const char*)p, (const char*)p+len));
+        p += len;
+    }
+    return true;
+}
+
+// Interns a validated cache dictionary into the shared names, updating
+// remap to the shared IDs
+static void mergeCacheDictionary(const StringInterner &cached, StringInterner &names, QVector<quint32> &remap)
+{
+    for(int i=0; i<remap.size(); i++)
+        remap[i] = names.intern(cached.at(remap[i]));
+}
+
+// Whether every cached UID has a dictionary entry
+static bool validCacheUids(const qint64 *uids, qint64 numSamples, const QVector<quint32> &remap)
+{
+    for(qint64 i=0; i<numSamples; i++)
+    {
+        if((quint64)uids[i] >= (quint64)remap.size())
+            return false;
+    }
+    return true;
+}
+
+static void writeCacheDictionary(QIODevice &out, const StringInterner &names)
+{
+    quint32 count = names.size();
+    out.write((const char*)&count, sizeof(count));
+    for(int i=0; i<names.size(); i++)
+    {
+        QByteArray utf8 = names.at(i).toUtf8();
+        quint32 len = utf8.size();
+        out.write((const char*)&len, sizeof(len));
+        out.write(utf8.constData(), len);
+    }
+}
+
+int DataObject::readSampleCache(QString cacheFileName, quint64 fingerprint)
+{
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    QFile cacheFile(cacheFileName);
+    if(!cacheFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    qint64 size = cacheFile.size();
+    if(size < (qint64)sizeof(SampleCacheHeader))
+        return -1;
+
+    const uchar *map = cacheFile.map(0, size);
+    if(map == NULL)
+        return -1;
+
+    SampleCacheHeader header;
+    memcpy(&header, map, sizeof(header));
+
+    // The sample count is checked against the file size before it is
+    // used in any arithmetic
+    quint64 maxSamples = (quint64)(size - sizeof(header)) / (NUM_SAMPLE_AXES*sizeof(qint64));
+    if(header.magic != SAMPLE_CACHE_MAGIC ||
+       header.version != SAMPLE_CACHE_VERSION ||
+       header.fingerprint != fingerprint ||
+       header.numColumns != NUM_SAMPLE_AXES ||
+       header.numDictionaries != SAMPLE_CACHE_DICTIONARIES ||
+       header.numSamples > maxSamples)
+    {
+        cacheFile.unmap((uchar*)map);
+        return -1;
+    }
+
+    qint64 numSamples = header.numSamples;
+    qint64 columnBytes = numSamples * sizeof(qint64);
+    const qint64 *columns = (const qint64*)(map + sizeof(header));
+    const uchar *p = map + sizeof(header) + NUM_SAMPLE_AXES*columnBytes;
+    const uchar *end = map + size;
+
+    // Nothing shared is touched until the whole cache is known to be valid
+    StringInterner cachedSources, cachedInstructions, cachedVariables;
+    QVector<quint32> sourceRemap, instructionRemap, variableRemap;
+    if(!readCacheDictionary(p, end, cachedSources, sourceRemap) ||
+       !readCacheDictionary(p, end, cachedInstructions, instructionRemap) ||
+       !readCacheDictionary(p, end, cachedVariables, variableRemap) ||
+       !validCacheUids(columns + SampleAxes::sourceUid*numSamples, numSamples, sourceRemap) ||
+       !validCacheUids(columns + SampleAxes::instructionUid*numSamples, numSamples, instructionRemap) ||
+       !validCacheUids(columns + SampleAxes::variableUid*numSamples, numSamples, variableRemap))
+    {
+        cacheFile.unmap((uchar*)map);
+        return -1;
+    }
+
+    clearSampleNames();
+    mergeCacheDictionary(cachedSources, sourceNames, sourceRemap);
+    mergeCacheDictionary(cachedInstructions, instructionNames, instructionRemap);
+    mergeCacheDictionary(cachedVariables, variableNames, variableRemap);
+
+    samples.clear();
+    samples.resize(numSamples);
+
+    parallelChunks(NUM_SAMPLE_AXES, NUM_SAMPLE_AXES, [&](int, long long begin, long long end)
+    {
+        for(long long axis=begin; axis<end; axis++)
         {
-            qDebug( "Source or target component not found (cpu %d %p data source %d %p)", s.cpu, compTarget, s.data_src, compSrc);
+            const qint64 *src = columns + axis*numSamples;
+            std::copy(src, src+numSamples, samples.column(axis));
         }
-        else
+    });
+
+    // Translate cached UIDs to interned IDs
+    long long *sourceUids = samples.column(SampleAxes::sourceUid);
+    long long *instructionUids = samples.column(SampleAxes::instructionUid);
+    long long *variableUids = samples.column(SampleAxes::variableUid);
+    for(qint64 i=0; i<numSamples; i++)
+    {
+        sourceUids[i] = sourceRemap[sourceUids[i]];
+        instructionUids[i] = instructionRemap[instructionUids[i]];
+        variableUids[i] = variableRemap[variableUids[i]];
+    }
+
+    cacheFile.unmap((uchar*)map);
+    cacheFile.close();
+
+    logMessage(QString("Loaded %1 samples from cache %2 in %3 s")
+               .arg(numSamples)
+               .arg(cacheFileName)
+               .arg(loadTimer.elapsed()/1000.0,0,'f',2));
+
+    return 0;
+}
+
+int DataObject::writeSampleCache(QString cacheFileName, quint64 fingerprint)
+{
+    QSaveFile cacheFile(cacheFileName);
+    if(!cacheFile.open(QIODevice::WriteOnly))
+        return -1;
+
+    SampleCacheHeader header;
+    header.magic = SAMPLE_CACHE_MAGIC;
+    header.version = SAMPLE_CACHE_VERSION;
+    header.fingerprint = fingerprint;
+    header.numSamples = samples.size();
+    header.numColumns = NUM_SAMPLE_AXES;
+    header.numDictionaries = SAMPLE_CACHE_DICTIONARIES;
+    cacheFile.write((const char*)&header, sizeof(header));
+
+    for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+        cacheFile.write((const char*)samples.column(axis), samples.size()*sizeof(qint64));
+
+    writeCacheDictionary(cacheFile, sourceNames);
+    writeCacheDictionary(cacheFile, instructionNames);
+    writeCacheDictionary(cacheFile, variableNames);
+
+    if(!cacheFile.commit())
+        return -1;
+
+    logMessage("Wrote sample cache "+cacheFileName);
+    return 0;
+}
+
+// Called when the samples are replaced, so the interners only hold the
+// names of the loaded data set
+void DataObject::clearSampleNames()
+{
+    sourceNames.clear();
+    instructionNames.clear();
+    variableNames.clear();
+}
+
+void DataObject::logMessage(QString msg)
+{
+    if(messageHandler)
+        messageHandler(msg);
+    else
+        std::cout << msg.toStdString() << std::endl;
+}
+
+// Walks up from a hardware thread to the component serving dseDepth level
+// dataSrc (-1 stays on the thread itself)
+static Component *findDataSource(Component *thread, int dataSrc)
+{
+    Component *c = thread;
+    while(c != NULL && dataSrc != -1){
+        c = c->GetParent();
+        if(c == NULL) break;
+        if(dataSrc == 1
+            && c->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
+            && ((Cache*)c)->GetCacheLevel()==1) break;//L1
+        else if(dataSrc == 2
+            && c->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
+            && ((Cache*)c)->GetCacheLevel()==2) break;//L2
+        else if(dataSrc == 3
+            && c->GetComponentType() == SYS_SAGE_COMPONENT_CACHE
+            && ((Cache*)c)->GetCacheLevel()==3) break;//L3
+        else if(dataSrc == 4
+            && (c->GetComponentType() == SYS_SAGE_COMPONENT_NUMA
+            || c->GetComponentType() == SYS_SAGE_COMPONENT_CHIP)) break;//main memory
+    }
+    return c;
+}
+
+void DataObject::buildSampleRoutes()
+{
+    vector<Component*> allComponents;
+    node->GetSubtreeNodeList(&allComponents);
+
+    int maxCpu = -1;
+    for(Component *c : allComponents)
+        if(c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD)
+            maxCpu = std::max(maxCpu, c->GetId());
+
+    SampleRoute noRoute = {NULL, NULL, NULL};
+    sampleRoutes.fill(noRoute, (maxCpu+1)*NUM_DATA_SOURCES);
+
+    for(Component *c : allComponents)
+    {
+        if(c->GetComponentType() != SYS_SAGE_COMPONENT_THREAD || c->GetId() < 0)
+            continue;
+
+        // Like FindSubcomponentById, the first thread with an id wins
+        if(sampleRoutes[c->GetId()*NUM_DATA_SOURCES].thread != NULL)
+            continue;
+
+        for(int dataSrc=-1; dataSrc<NUM_DATA_SOURCES-1; dataSrc++)
         {
+            SampleRoute &route = sampleRoutes[c->GetId()*NUM_DATA_SOURCES + dataSrc+1];
+            route.thread = c;
+            route.source = findDataSource(c, dataSrc);
+
+            // Reuse a sample DataPath that already connects the two
             vector<DataPath*> dp_vec;
-            compTarget->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, SYS_SAGE_DATAPATH_INCOMING);
-            bool dp_exists = false;
-            DataPath* dp;
+            c->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, SYS_SAGE_DATAPATH_INCOMING);
             for(DataPath* dp_iter : dp_vec){
-                if(dp_iter->GetSource() == compSrc){
-                    dp = dp_iter;
-                    dp_exists = true;
+                if(dp_iter->GetSource() == route.source){
+                    route.dataPath = dp_iter;
                     break;
                 }
             }
-            if(!dp_exists){ //no sample connecting the two components
-                dp = NewDataPath(compSrc, compTarget, SYS_SAGE_DATAPATH_ORIENTED, SYS_SAGE_MITOS_SAMPLE);
-                dp->attrib["samples"] = (void*)new vector<Sample*>();
-                dp->attrib["sel_samples"] = (void*)new vector<Sample*>();
-                dp->attrib["sample_set"] = (void*)new SampleSet();
-                SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
-                ss->totCycles = 0;
-                ss->selCycles = 0;
-                ss->totSamples.clear();
-                ss->selSamples.clear();
-            }
-            ((vector<Sample*>*)(dp->attrib["samples"]))->push_back(&(samples[elemid]));
-            ((vector<Sample*>*)(dp->attrib["sel_samples"]))->push_back(&(samples[elemid]));
-            SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
-            ss->totCycles += s.latency;
-            ss->selCycles += s.latency;
-            ss->totSamples.insert(elemid);
-            ss->selSamples.insert(elemid);
         }
-        elemid++;
-
-
-
-        //
-        //
-        // // Process individual dimensions differently
-        // for(int i=0; i<lineValues.size(); i++)
-        // {
-        //     QString tok = lineValues[i];
-        //     if(i==variableDim)
-        //     {
-        //         ElemIndex uid = createUniqueID(varVec,tok);
-        //         this->vals.push_back(uid);
-        //         varNames.push_back(tok);
-        //     }
-        //     else if(i==sourceDim)
-        //     {
-        //         ElemIndex uid = createUniqueID(sourceVec,tok);
-        //         this->vals.push_back(uid);
-        //         fileNames.push_back(tok);
-        //     }
-        //     else if(i==dataSourceDim)
-        //     {
-        //         int dseVal = tok.toInt(NULL,10);
-        //         int dse = dseDepth(dseVal);
-        //         // qDebug("elem %d dseVal %d dse %d", elemid, dseVal, dse);
-        //         this->vals.push_back(dse);
-        //     }
-        //     else
-        //     {
-        //         this->vals.push_back(tok.toLongLong());
-        //     }
-        // }
-
     }
+}
 
-    // Close and return
-    dataFile.close();
+SampleRoute *DataObject::sampleRoute(int cpu, int dataSrc)
+{
+    long long idx = (long long)cpu*NUM_DATA_SOURCES + dataSrc+1;
+    if(cpu < 0 || dataSrc < -1 || dataSrc >= NUM_DATA_SOURCES-1 || idx >= sampleRoutes.size())
+        return NULL;
+    return &sampleRoutes[idx];
+}
 
-    this->allocate();
+void DataObject::bindSamplesToTopology()
+{
+    const long long *cpus = samples.column(SampleAxes::cpu);
+    const long long *dataSrcs = samples.column(SampleAxes::dataSrc);
+    const long long *latencies = samples.column(SampleAxes::latency);
 
-    return 0;
+    for(ElemIndex elemid=0; elemid<samples.size(); elemid++)
+    {
+        int cpu = cpus[elemid];
+        int data_src = dataSrcs[elemid];
+
+        //add samples as DataPath pointers
+        SampleRoute *route = sampleRoute(cpu, data_src);
+        if(route == NULL || route->thread == NULL || route->source == NULL)
+        {
+            qDebug( "Source or target component not found (cpu %d data source %d)", cpu, data_src);
+            continue;
+        }
+
+        if(route->dataPath == NULL){ //no sample connecting the two components
+            DataPath *dp = NewDataPath(route->source, route->thread, SYS_SAGE_DATAPATH_ORIENTED, SYS_SAGE_MITOS_SAMPLE);
+            dp->attrib["sample_set"] = (void*)new SampleSet();
+            SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
+            ss->totCycles = 0;
+            ss->selCycles = 0;
+            ss->totSamples.clear();
+            ss->selSamples.clear();
+            route->dataPath = dp;
+        }
+        SampleSet *ss = (SampleSet*)route->dataPath->attrib["sample_set"];
+        ss->totCycles += latencies[elemid];
+        ss->selCycles += latencies[elemid];
+        ss->totSamples.insert(elemid);
+        ss->selSamples.insert(elemid);
+    }
 }
 
 void DataObject::setSelectionMode(selection_mode mode, bool silent)
@@ -820,197 +1563,48 @@ void DataObject::setSelectionMode(selection_mode mode, bool silent)
             selcmd += "filter";
             break;
     }
-    con->log(selcmd);
-}
-
-long long DataObject::GetSampleAttribByIndex(Sample* s, int attrib_idx)
-{
-    switch((SampleAxes::SampleAxes)attrib_idx){
-        case SampleAxes::sampleId://0
-            return s->sampleId;
-        case SampleAxes::sourceUid://1
-            return s->sourceUid;
-        case SampleAxes::line://2
-            return s->line;
-        case SampleAxes::instructionUid://3
-            return s->instructionUid;
-        case SampleAxes::bytes: //4
-            return s->bytes;
-        case SampleAxes::ip: //5
-            return s->ip;
-        case SampleAxes::variableUid://6
-            return s->variableUid;
-        case SampleAxes::buffer_size: //7
-            return s->buffer_size;
-        case SampleAxes::dims: //8
-            return s->dims;
-        case SampleAxes::xidx://9
-            return s->xidx;
-        case SampleAxes::yidx://10
-            return s->yidx;
-        case SampleAxes::zidx://11
-            return s->zidx;
-        case SampleAxes::pid: //12
-            return s->pid;
-        case SampleAxes::tid: //13
-            return s->tid;
-        case SampleAxes::time: //14
-            return s->time;
-        case SampleAxes::addr: //15
-            return s->addr;
-        case SampleAxes::cpu://16
-            return s->cpu;
-        case SampleAxes::latency://17
-            return s->latency;
-        case SampleAxes::dataSrc://18
-            return s->data_src;
-        default:
-            return -999999999;
-    }
+    logMessage(selcmd);
 }
 
-long long DataObject::GetSampleAttribByIndex(int sampleId, int attrib_idx)
+long long DataObject::GetSampleAttribByIndex(ElemIndex sampleId, int attrib_idx)
 {
-
-    if(sampleId >= samples.size())
+    if(sampleId >= samples.size() || attrib_idx < 0 || attrib_idx >= NUM_SAMPLE_AXES)
         return -999999999;
-    Sample s = samples[sampleId];
-    return GetSampleAttribByIndex(&s,attrib_idx);
+    return samples.value(sampleId, attrib_idx);
 }
 
 void DataObject::calcStatistics()
 {
+    AxisMoments moments[NUM_SAMPLE_AXES];
+    calcAxisMoments(samples, NULL, moments);
+
     sample_sums.resize(NUM_SAMPLE_AXES);
     sample_mins.resize(NUM_SAMPLE_AXES);
     sample_maxes.resize(NUM_SAMPLE_AXES);
     sample_means.resize(NUM_SAMPLE_AXES);
     sample_stdevs.resize(NUM_SAMPLE_AXES);
 
-    sample_sums.fill(0);
-    sample_mins.fill(9999999999);
-    sample_maxes.fill(0);
-    sample_means.fill(0);
-    sample_stdevs.fill(0);
-
-    // dimSums.resize(this->numDimensions);
-    // minimumValues.resize(this->numDimensions);
-    // maximumValues.resize(this->numDimensions);
-    // meanValues.resize(this->numDimensions);
-    // standardDeviations.resize(this->numDimensions);
-    //
-    // covarianceMatrix.resize(this->numDimensions*this->numDimensions);
-    // correlationMatrix.resize(this->numDimensions*this->numDimensions);
-    //
-    // qreal firstVal = *(this->begin);
-    // dimSums.fill(0);
-    // minimumValues.fill(9999999999);
-    // maximumValues.fill(0);
-    // meanValues.fill(0);
-    // standardDeviations.fill(0);
-    //
-    // // Means and combined means
-    // QVector<qreal>::Iterator p;
-    // ElemIndex elem;
-    // qreal x, y;
-
-    for(Sample s : samples)
-    {
-        for(int i=0; i<NUM_SAMPLE_AXES; i++)
-        {
-            long long val = GetSampleAttribByIndex(&s, i);
-            sample_sums[i] += val;
-            sample_mins[i] = std::min((qreal)val,sample_mins[i]);
-            sample_maxes[i] = std::max((qreal)val,sample_maxes[i]);
-        }
-    }
-
-    int numSamples = samples.size();
-    for(int i=0; i<NUM_SAMPLE_AXES; i++)
-    {
-        sample_means[i] = sample_sums[i]/numSamples;
-    }
-
-    for(Sample s: samples)
-    {
-        for(int i=0; i<NUM_SAMPLE_AXES; i++)
-        {
-            long long val = GetSampleAttribByIndex(&s, i);
-            sample_stdevs[i] += (val-sample_means[i])*(val-sample_means[i]);
-        }
-    }
-
     for(int i=0; i<NUM_SAMPLE_AXES; i++)
     {
-        sample_stdevs[i] = sqrt(sample_stdevs[i]/numSamples);
+        sample_sums[i] = moments[i].sum;
+        sample_mins[i] = moments[i].min;
+        sample_maxes[i] = moments[i].max;
+        sample_means[i] = moments[i].mean;
+        sample_stdevs[i] = moments[i].stddev();
     }
 
-    //TODO this part was not refactored
+    calcCoMoments(samples, NULL, sample_comoments);
+    calcSelectionStatistics();
+}
 
-    // QVector<qreal> meanXY;
-    // meanXY.resize(this->numDimensions*this->numDimensions);
-    // meanXY.fill(0);
-    // for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
-    // {
-    //     for(int i=0; i<this->numDimensions; i++)
-    //     {
-    //         x = *(p+i);
-    //         dimSums[i] += x;
-    //         minimumValues[i] = std::min(x,minimumValues[i]);
-    //         maximumValues[i] = std::max(x,maximumValues[i]);
-    //
-    //         for(int j=0; j<this->numDimensions; j++)
-    //         {
-    //             y = *(p+j);
-    //             meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] += x*y;
-    //         }
-    //     }
-    // }
-    //
-    // // Divide by this->numElements to get mean
-    // for(int i=0; i<this->numDimensions; i++)
-    // {
-    //     meanValues[i] = dimSums[i] / (qreal)this->numElements;
-    //     for(int j=0; j<this->numDimensions; j++)
-    //     {
-    //         meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] /= (qreal)this->numElements;
-    //     }
-    // }
-    //
-    // // Covariance = E(XY) - E(X)*E(Y)
-    // for(int i=0; i<this->numDimensions; i++)
-    // {
-    //     for(int j=0; j<this->numDimensions; j++)
-    //     {
-    //         covarianceMatrix[ROWMAJOR_2D(i,j,this->numDimensions)] =
-    //             meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] - meanValues[i]*meanValues[j];
-    //     }
-    // }
-    //
-    // // Standard deviation of each dim
-    // for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
-    // {
-    //     for(int i=0; i<this->numDimensions; i++)
-    //     {
-    //         x = *(p+i);
-    //         standardDeviations[i] += (x-meanValues[i])*(x-meanValues[i]);
-    //     }
-    // }
-    //
-    // for(int i=0; i<this->numDimensions; i++)
-    // {
-    //     standardDeviations[i] = sqrt(standardDeviations[i]/(qreal)this->numElements);
-    // }
-    //
-    // // Correlation Coeff = cov(xy) / stdev(x)*stdev(y)
-    // for(int i=0; i<this->numDimensions; i++)
-    // {
-    //     for(int j=0; j<this->numDimensions; j++)
-    //     {
-    //         correlationMatrix[ROWMAJOR_2D(i,j,this->numDimensions)] =
-    //                 covarianceMatrix[ROWMAJOR_2D(i,j,this->numDimensions)] /
-    //                 (standardDeviations[i]*standardDeviations[j]);
-    //     }
-    // }
+// Uses the running co-moments of the union of all groups; no pass over
+// the samples
+void DataObject::calcSelectionStatistics()
+{
+    if(!selectionDefined())
+        selection_comoments = sample_comoments;
+    else
+        selection_comoments = union_comoments;
 }
 
 // void DataObject::constructSortedLists()
@@ -1056,8 +1650,8 @@ qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2)
     // Collect s1 topo data
     for(it = s1->begin(); it != s1->end(); it++)
     {
-        lat = d->samples[*it].latency;
-        dseDepth = d->samples[*it].data_src;
+        lat = d->samples.value(*it,SampleAxes::latency);
+        dseDepth = d->samples.value(*it,SampleAxes::dataSrc);
         // lat = d->at(*it,d->latencyDim);
         // dseDepth = d->at(*it,d->dataSourceDim);
         t1[nodeTopoDepth] += lat;
@@ -1067,8 +1661,8 @@ qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2)
     // Collect s2 topo data
     for(it = s2->begin(); it != s2->end(); it++)
     {
-        lat = d->samples[*it].latency;
-        dseDepth = d->samples[*it].data_src;
+        lat = d->samples.value(*it,SampleAxes::latency);
+        dseDepth = d->samples.value(*it,SampleAxes::dataSrc);
         // lat = d->at(*it,d->latencyDim);
         // dseDepth = d->at(*it,d->dataSourceDim);
         t2[nodeTopoDepth] += lat;
@@ -1085,16 +1679,16 @@ qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2)
     // Compute standard deviations
     for(it = s1->begin(); it != s1->end(); it++)
     {
-        lat = d->samples[*it].latency;
-        dseDepth = d->samples[*it].data_src;
+        lat = d->samples.value(*it,SampleAxes::latency);
+        dseDepth = d->samples.value(*it,SampleAxes::dataSrc);
         // lat = d->at(*it,d->latencyDim);
         // dseDepth = d->at(*it,d->dataSourceDim);
         t1stddev[dseDepth] += (lat-t1means.at(dseDepth))*(lat-t1means.at(dseDepth));
     }
     for(it = s2->begin(); it != s2->end(); it++)
     {
-        lat = d->samples[*it].latency;
-        dseDepth = d->samples[*it].data_src;
+        lat = d->samples.value(*it,SampleAxes::latency);
+        dseDepth = d->samples.value(*it,SampleAxes::dataSrc);
         // lat = d->at(*it,d->latencyDim);
         // dseDepth = d->at(*it,d->dataSourceDim);
         t2stddev[dseDepth] += (lat-t2means.at(dseDepth))*(lat-t2means.at(dseDepth));
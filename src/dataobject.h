@@ -39,109 +39,48 @@
 #ifndef DATAOBJECT_H
 #define DATAOBJECT_H
 
-#include <QWidget>
-#include <QBitArray>
 
 #include <map>
 #include <set>
 #include <vector>
 #include <assert.h>
 #include <chrono>
+#include <deque>
+#include <functional>
 
 
 #include "hwtopo.h"
+#include "bitmask.h"
+#include "elemset.h"
+#include "samplestats.h"
+#include "sampletable.h"
+#include "stringinterner.h"
 #include "util.h"
-#include "console.h"
 
 #include "sys-sage.hpp"
 
 #define INVISIBLE false
 #define VISIBLE true
 #define SYS_SAGE_MITOS_SAMPLE 4096
-#define NUM_SAMPLE_AXES 19
+#define NUM_DATA_SOURCES 6 // dseDepth values -1..4
+#define MAX_SELECTION_GROUPS 8 // groups 1..8, 0 means unselected
+#define ACTIVE_GROUP -1
+#define SELECTION_HISTORY_STEPS 64
 
 // class hwTopo;
 // class hwNode;
-class console;
 
-typedef unsigned long long ElemIndex;
-typedef std::set<ElemIndex> ElemSet;
+// Receives status messages of the data set (the GUI console, or stdout
+// when none is set)
+typedef std::function<void(QString)> MessageHandler;
 
-
-struct Sample {
-public:
-    int sampleId;
-    ElemIndex sourceUid;
-    QString source;
-    long long line;
-    ElemIndex instructionUid;
-    QString instruction;
-    long long bytes;
-    long long ip;
-    ElemIndex variableUid;
-    QString variable;
-    long long buffer_size;
-    int dims;
-    int xidx;
-    int yidx;
-    int zidx;
-    int pid;
-    int tid;
-    long long time;
-    long long addr;
-    int cpu;
-    long long latency;
-    int data_src;
-
-    bool visible;
-};
-
-namespace SampleAxes
+// Where the samples of one (cpu, data source) pair attach to the topology
+struct SampleRoute
 {
-    enum SampleAxes{ //#define NUM_SAMPLE_AXES 19
-        sampleId = 0,
-        sourceUid = 1,
-        line = 2,
-        instructionUid = 3,
-        bytes = 4,
-        ip = 5,
-        variableUid = 6,
-        buffer_size = 7,
-        dims = 8,
-        xidx = 9,
-        yidx = 10,
-        zidx = 11,
-        pid = 12,
-        tid = 13,
-        time = 14,
-        addr = 15,
-        cpu = 16,
-        latency = 17,
-        dataSrc = 18
-    };
-    const QStringList SampleAxesNames = {
-        "sample ID", //0
-        "source file UID", //1
-        "source line", //2
-        "instruction UID", //3
-        "bytes", //4
-        "instruction pointer", //5
-        "variable UID", //6
-        "buffer size", //7
-        "#dims", //8
-        "x-index", //9
-        "y-index", //10
-        "z-index", //11
-        "PID", //12
-        "TID", //13
-        "timestamp", //14
-        "data address", //15
-        "CPU core", //16
-        "load latency", //17
-        "data source" //18
-    };
-}
-
+    Component *thread;
+    Component *source;
+    DataPath *dataPath; // created when the first sample is bound
+};
 
 enum selection_mode
 {
@@ -150,6 +89,13 @@ enum selection_mode
     MODE_FILTER
 };
 
+enum group_op
+{
+    GROUP_UNION = 0,
+    GROUP_INTERSECTION,
+    GROUP_DIFFERENCE
+};
+
 struct indexedValue
 {
     ElemIndex idx;
@@ -163,6 +109,17 @@ struct indexedValue
 
 typedef std::vector<indexedValue> IndexList;
 
+// Change of one selection group, kept as the (compressed) sets of samples
+// that entered and left it rather than a copy of the group
+struct GroupDelta
+{
+    int group;
+    ElemSet added;
+    ElemSet removed;
+};
+
+typedef std::vector<GroupDelta> SelectionStep;
+
 // Distance Functions (for clustering)
 typedef qreal (*distance_metric_fn_t)(DataObject *d, ElemSet *s1, ElemSet *s2);
 qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2);
@@ -178,29 +135,77 @@ public:
     // Initialization
     int loadData(QString filename);
     int loadHardwareTopology(QString filename);
+    // Parses a samples CSV only, bypassing the cache and the topology;
+    // loadData() is the normal entry point
+    int parseCSVFile(QString dataFileName);
+
+    // Also closes the current selection history step
+    void selectionChanged() { commitSelectionStep(); updateTopoSamples(); calcSelectionStatistics(); }
+    void visibilityChanged() { updateTopoSamples(); }
+
+    // Adjusts the per-DataPath selected samples and the component
+    // transaction counts for samples entering/leaving the selection
+    void applySelectionDelta(const ElemSet &added, const ElemSet &removed);
 
-    void selectionChanged() { collectTopoSamples(); }
-    void visibilityChanged() { collectTopoSamples(); }
+    void setMessageHandler(MessageHandler handler) { messageHandler = handler; }
 
-    void setConsole(console *c) { con = c; }
+    // Per-component selection totals, refreshed with the topology samples
+    const ComponentTable &components() const { return componentTable; }
 
 private:
     void allocate();
     void collectTopoSamples();
-    int parseCSVFile(QString dataFileName);
-    int DecodeDataSource(QString data_src_str);
+    void updateTopoSamples();
+    int groupIndex(int group) const { return group == ACTIVE_GROUP ? selGroup : group; }
+    void setGroupSet(int group, ElemSet newSel);
+    void updateMoments(CoMoments &moments, const ElemSet &set, const ElemSet &added, const ElemSet &removed);
+    int lowestGroup(ElemIndex elem);
+    void commitSelectionStep();
+    bool recordingHistory() const { return !replayingHistory && !batchingSelection; }
+    void replaySelectionStep(const SelectionStep &step, bool forward);
+    void addTopoSample(ElemIndex elem, int sign);
+    QString sampleCacheFileName(QString dataFileName);
+    int readSampleCache(QString cacheFileName, quint64 fingerprint);
+    void clearSampleNames();
+    int writeSampleCache(QString cacheFileName, quint64 fingerprint);
+    void buildSampleRoutes();
+    SampleRoute *sampleRoute(int cpu, int dataSrc);
+    void bindSamplesToTopology();
+    void logMessage(QString msg);
+    int DecodeDataSource(QLatin1String data_src_str);
 public:
     // Selection & Visibility
+    //
+    // Selection groups 1..MAX_SELECTION_GROUPS are independent sets that
+    // may overlap, e.g. to classify samples. Functions taking a group act
+    // on the active group by default; the selection mode applies within
+    // the target group.
     selection_mode selectionMode() { return selMode; }
     void setSelectionMode(selection_mode mode, bool silent = false);
+    int activeGroup() const { return selGroup; }
+    void setActiveGroup(int group);
     int selected(ElemIndex index);
     bool visible(ElemIndex index);
     bool selectionDefined();
 
-    void selectData(ElemIndex index, int group = 1);
-    void selectAll(int group = 1);
+    void selectData(ElemIndex index, int group = ACTIVE_GROUP);
+    void selectAll(int group = ACTIVE_GROUP);
     void deselectAll();
-    void selectAllVisible(int group = 1);
+
+    // Selection history. The changes between two selectionChanged() calls
+    // form one step; undo and redo replay a step's deltas, so the groups,
+    // statistics and topology update incrementally. Announce the result
+    // with selectionChanged() as after any other selection.
+    bool undoSelection();
+    bool redoSelection();
+    bool canUndo() const { return !undoSteps.empty() || !pendingStep.empty(); }
+    bool canRedo() const { return !redoSteps.empty(); }
+    // Folds every change until endSelectionBatch() into one step from
+    // the selection at beginSelectionBatch(), e.g. for animations that
+    // reselect on every frame
+    void beginSelectionBatch();
+    void endSelectionBatch();
+    void selectAllVisible(int group = ACTIVE_GROUP);
 
     void showData(unsigned int index);
     void hideData(unsigned int index);
@@ -209,30 +214,53 @@ public:
     void hideSelected();
     void hideUnselected();
 
-    void selectSet(ElemSet &s, int group = 1);
+    void selectSet(const ElemSet &s, int group = ACTIVE_GROUP);
     //void selectByDimRange(int dim, qreal vmin, qreal vmax, int group = 1);
-    void selectByLineRange(qreal vmin, qreal vmax, int group = 1);
-    void selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group = 1);
-    void selectBySourceFileName(QString str, int group = 1);
-    void selectByVarName(QString str, int group = 1);
-    void selectByResource(Component *c, int group = 1);
-
-    ElemSet& getSelectionSet(int group = 1) { return selectionSets.at(group); }
+    void selectByLineRange(qreal vmin, qreal vmax, int group = ACTIVE_GROUP);
+    void selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group = ACTIVE_GROUP);
+    ElemSet multiDimRangeSet(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes);
+    void selectBySourceFileName(QString str, int group = ACTIVE_GROUP);
+    void selectByVarName(QString str, int group = ACTIVE_GROUP);
+    void selectByResource(Component *c, int group = ACTIVE_GROUP);
+
+    // dst = a op b, a chunk of the group bitmaps at a time
+    void combineGroups(int dst, int a, int b, group_op op);
+    void clearGroup(int group);
+
+    const ElemSet& getSelectionSet(int group = ACTIVE_GROUP) { return selectionSets.at(groupIndex(group)); }
+    const CoMoments &groupMoments(int group) const { return group_comoments.at(groupIndex(group)); }
+
+    // Samples the topology counts as selected: those in any selection
+    // group, or all of them when nothing is selected
+    ElemSet topoSelection();
+    // Samples in any selection group
+    const ElemSet &selectedSet() const { return selectedUnion; }
+
+    // Implicitly shared copies, cheap to hand to background jobs. The
+    // group of a sample is the lowest group it is in (0 if none), which
+    // views use to colour by group.
+    BitMask visibilityMask() const { return visibility; }
+    QVector<quint8> selectionGroups() const { return selectionGroup; }
 
     // Calculated statistics
     void calcStatistics();
-    // void constructSortedLists();
+    void calcSelectionStatistics();
+    void constructSortedList(int dim);
 
     // qreal at(int i, int d) const { return vals[i*numDimensions+d]; }
-    // qreal sumAt(int d) const { return dimSums[d]; }
-    // qreal minAt(int d) const { return minimumValues[d]; }
-    // qreal maxAt(int d) const { return maximumValues[d]; }
-    // qreal meanAt(int d) const { return meanValues[d]; }
-    // qreal stddevAt(int d) const { return standardDeviations[d]; }
-    // qreal covarianceBtwn(int d1,int d2) const
-    //     { return covarianceMatrix[ROWMAJOR_2D(d1,d2,numDimensions)]; }
-    // qreal correlationBtwn(int d1,int d2) const
-    //     { return correlationMatrix[ROWMAJOR_2D(d1,d2,numDimensions)]; }
+    qreal sumAt(int d) const { return sample_sums[d]; }
+    qreal minAt(int d) const { return sample_mins[d]; }
+    qreal maxAt(int d) const { return sample_maxes[d]; }
+    qreal meanAt(int d) const { return sample_means[d]; }
+    qreal stddevAt(int d) const { return sample_stdevs[d]; }
+
+    // Statistics of the selected samples (all samples if none are selected)
+    qreal selectionMeanAt(int d) const { return selection_comoments.mean[d]; }
+    qreal selectionStddevAt(int d) const { return qSqrt(selection_comoments.covariance(d,d)); }
+    qreal selectionCovarianceBtwn(int d1,int d2) const { return selection_comoments.covariance(d1,d2); }
+    qreal selectionCorrelationBtwn(int d1,int d2) const { return selection_comoments.correlation(d1,d2); }
+    qreal covarianceBtwn(int d1,int d2) const { return sample_comoments.covariance(d1,d2); }
+    qreal correlationBtwn(int d1,int d2) const { return sample_comoments.correlation(d1,d2); }
 
     // Hierarchical clustering
     void cluster(distance_metric_fn_t dfn);
@@ -266,24 +294,49 @@ public:
     // QVector<qreal>::Iterator begin;
     // QVector<qreal>::Iterator end;
 
-    QVector<Sample> samples;
-    long long GetSampleAttribByIndex(Sample* s, int attrib_idx);
-    long long GetSampleAttribByIndex(int sampleId, int attrib_idx);
+    SampleTable samples;
+    // Interned names, kept across loads so IDs stay stable
+    StringInterner sourceNames;
+    StringInterner instructionNames;
+    StringInterner variableNames;
+    long long GetSampleAttribByIndex(ElemIndex sampleId, int attrib_idx);
 
 private:
-    // QBitArray visibility; //TODO move to Sample struct?
-    QVector<int> selectionGroup;
+    BitMask visibility;
+    QVector<SampleRoute> sampleRoutes; // [cpu*NUM_DATA_SOURCES + dataSrc+1]
+    QVector<quint8> selectionGroup; // lowest group of each sample
     std::vector<ElemSet> selectionSets;
+    ElemSet selectedUnion;
+
+    // Selection history, newest steps at the back
+    SelectionStep pendingStep;
+    std::deque<SelectionStep> undoSteps;
+    std::vector<SelectionStep> redoSteps;
+    bool replayingHistory;
+    bool batchingSelection;
+    std::vector<ElemSet> batchStartSets;
+
+    // Samples currently counted in the topology's selected sample sets
+    ElemSet topoSelected;
+    ComponentTable componentTable;
+    bool topoSamplesValid;
 
     QVector<qreal> sample_sums;
     QVector<qreal> sample_mins;
     QVector<qreal> sample_maxes;
     QVector<qreal> sample_means;
     QVector<qreal> sample_stdevs;
+    CoMoments sample_comoments;
+    CoMoments selection_comoments;
+    // Running co-moments of each selection group and of their union,
+    // moved along by the deltas of every selection change
+    std::vector<CoMoments> group_comoments;
+    CoMoments union_comoments;
     // Sample sample_covarianceMatrix;
     // Sample sample_correlationMatrix;
 
-    // std::vector<IndexList> dimSortedLists;
+    // Row indices sorted by value, per axis (built on first range query)
+    std::vector<quint32> dimSortedLists[NUM_SAMPLE_AXES];
 
     // QVector<qreal> dimSums;
     // QVector<qreal> minimumValues;
@@ -294,7 +347,7 @@ private:
     // QVector<qreal> correlationMatrix;
 
 private:
-    console *con;
+    MessageHandler messageHandler;
     // QVector<DataObject*> dataObjects;
 
     int selGroup;
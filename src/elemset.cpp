@@ -0,0 +1,553 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "elemset.h"
+
+#include <algorithm>
+
+static inline int popcount64(quint64 word)
+{
+    return __builtin_popcountll(word);
+}
+
+// Chunk
+
+bool ElemSet::Chunk::contains(quint16 low) const
+{
+    if(isBitmap())
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void ElemSet::Chunk::insert(quint16 low)
+{
+    if(isBitmap())
+    {
+        quint64 mask = 1ULL << (low & 63);
+        if(!(bits[low >> 6] & mask))
+        {
+            bits[low >> 6] |= mask;
+            cardinality++;
+        }
+        return;
+    }
+
+    // In-order inserts (the common case when scanning samples) append
+    if(array.empty() || array.back() < low)
+        array.push_back(low);
+    else
+    {
+        std::vector<quint16>::iterator it = std::lower_bound(array.begin(), array.end(), low);
+        if(*it == low)
+            return;
+        array.insert(it, low);
+    }
+    cardinality++;
+
+    if(cardinality > ELEMSET_ARRAY_MAX)
+        toBitmap();
+}
+
+void ElemSet::Chunk::erase(quint16 low)
+{
+    if(isBitmap())
+    {
+        quint64 mask = 1ULL << (low & 63);
+        if(bits[low >> 6] & mask)
+        {
+            bits[low >> 6] &= ~mask;
+            cardinality--;
+            if(cardinality <= ELEMSET_ARRAY_MAX)
+                toArray();
+        }
+        return;
+    }
+
+    std::vector<quint16>::iterator it = std::lower_bound(array.begin(), array.end(), low);
+    if(it != array.end() && *it == low)
+    {
+        array.erase(it);
+        cardinality--;
+    }
+}
+
+void ElemSet::Chunk::toBitmap()
+{
+    bits.assign(ELEMSET_BITMAP_WORDS, 0);
+    for(quint16 v : array)
+        bits[v >> 6] |= 1ULL << (v & 63);
+    std::vector<quint16>().swap(array);
+}
+
+void ElemSet::Chunk::toArray()
+{
+    array.clear();
+    array.reserve(cardinality);
+    for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+    {
+        quint64 word = bits[w];
+        while(word)
+        {
+            array.push_back(w*64 + __builtin_ctzll(word));
+            word &= word-1;
+        }
+    }
+    std::vector<quint64>().swap(bits);
+}
+
+ElemSet::Chunk ElemSet::unite(const Chunk &a, const Chunk &b)
+{
+    Chunk r;
+    if(a.isBitmap() || b.isBitmap())
+    {
+        const Chunk &bm = a.isBitmap() ? a : b;
+        const Chunk &other = a.isBitmap() ? b : a;
+        r.bits = bm.bits;
+        if(other.isBitmap())
+        {
+            for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+                r.bits[w] |= other.bits[w];
+        }
+        else
+        {
+            for(quint16 v : other.array)
+                r.bits[v >> 6] |= 1ULL << (v & 63);
+        }
+        r.cardinality = 0;
+        for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+            r.cardinality += popcount64(r.bits[w]);
+        return r;
+    }
+
+    r.array.resize(a.array.size() + b.array.size());
+    std::vector<quint16>::iterator end = std::set_union(a.array.begin(), a.array.end(),
+                                                        b.array.begin(), b.array.end(),
+                                                        r.array.begin());
+    r.array.erase(end, r.array.end());
+    r.cardinality = r.array.size();
+    if(r.cardinality > ELEMSET_ARRAY_MAX)
+        r.toBitmap();
+    return r;
+}
+
+ElemSet::Chunk ElemSet::intersect(const Chunk &a, const Chunk &b)
+{
+    Chunk r;
+    if(a.isBitmap() && b.isBitmap())
+    {
+        r.bits.resize(ELEMSET_BITMAP_WORDS);
+        for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+        {
+            r.bits[w] = a.bits[w] & b.bits[w];
+            r.cardinality += popcount64(r.bits[w]);
+        }
+        if(r.cardinality <= ELEMSET_ARRAY_MAX)
+            r.toArray();
+        return r;
+    }
+
+    if(a.isBitmap() || b.isBitmap())
+    {
+        const Chunk &bm = a.isBitmap() ? a : b;
+        const Chunk &arr = a.isBitmap() ? b : a;
+        for(quint16 v : arr.array)
+            if(bm.contains(v))
+                r.array.push_back(v);
+        r.cardinality = r.array.size();
+        return r;
+    }
+
+    r.array.resize(std::min(a.array.size(), b.array.size()));
+    std::vector<quint16>::iterator end = std::set_intersection(a.array.begin(), a.array.end(),
+                                                               b.array.begin(), b.array.end(),
+                                                               r.array.begin());
+    r.array.erase(end, r.array.end());
+    r.cardinality = r.array.size();
+    return r;
+}
+
+ElemSet::Chunk ElemSet::subtract(const Chunk &a, const Chunk &b)
+{
+    Chunk r;
+    if(a.isBitmap())
+    {
+        r.bits = a.bits;
+        if(b.isBitmap())
+        {
+            for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+                r.bits[w] &= ~b.bits[w];
+        }
+        else
+        {
+            for(quint16 v : b.array)
+                r.bits[v >> 6] &= ~(1ULL << (v & 63));
+        }
+        for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+            r.cardinality += popcount64(r.bits[w]);
+        if(r.cardinality <= ELEMSET_ARRAY_MAX)
+            r.toArray();
+        return r;
+    }
+
+    if(b.isBitmap())
+    {
+        for(quint16 v : a.array)
+            if(!b.contains(v))
+                r.array.push_back(v);
+        r.cardinality = r.array.size();
+        return r;
+    }
+
+    r.array.resize(a.array.size());
+    std::vector<quint16>::iterator end = std::set_difference(a.array.begin(), a.array.end(),
+                                                             b.array.begin(), b.array.end(),
+                                                             r.array.begin());
+    r.array.erase(end, r.array.end());
+    r.cardinality = r.array.size();
+    return r;
+}
+
+// ElemSet
+
+ElemIndex ElemSet::size() const
+{
+    ElemIndex n = 0;
+    for(const Chunk &chunk : chunks)
+        n += chunk.cardinality;
+    return n;
+}
+
+void ElemSet::clear()
+{
+    keys.clear();
+    chunks.clear();
+}
+
+ElemSet::Chunk *ElemSet::findChunk(ElemIndex k, bool create)
+{
+    // Fast path for in-order inserts
+    if(!keys.empty() && keys.back() == k)
+        return &chunks.back();
+
+    std::vector<ElemIndex>::iterator it = std::lower_bound(keys.begin(), keys.end(), k);
+    size_t idx = it - keys.begin();
+    if(it != keys.end() && *it == k)
+        return &chunks[idx];
+    if(!create)
+        return NULL;
+
+    keys.insert(it, k);
+    chunks.insert(chunks.begin()+idx, Chunk());
+    return &chunks[idx];
+}
+
+const ElemSet::Chunk *ElemSet::findChunk(ElemIndex k) const
+{
+    std::vector<ElemIndex>::const_iterator it = std::lower_bound(keys.begin(), keys.end(), k);
+    if(it == keys.end() || *it != k)
+        return NULL;
+    return &chunks[it - keys.begin()];
+}
+
+void ElemSet::insert(ElemIndex elem)
+{
+    findChunk(key(elem), true)->insert(low(elem));
+}
+
+void ElemSet::insertRange(ElemIndex begin, ElemIndex end)
+{
+    while(begin < end)
+    {
+        ElemIndex k = key(begin);
+        ElemIndex chunkEnd = std::min(end, (k+1) << 16);
+        Chunk *chunk = findChunk(k, true);
+
+        if(!chunk->isBitmap() && chunk->cardinality + (chunkEnd-begin) > ELEMSET_ARRAY_MAX)
+            chunk->toBitmap();
+
+        if(chunk->isBitmap())
+        {
+            for(ElemIndex e=begin; e<chunkEnd; e++)
+                chunk->bits[low(e) >> 6] |= 1ULL << (low(e) & 63);
+            chunk->cardinality = 0;
+            for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+                chunk->cardinality += popcount64(chunk->bits[w]);
+            if(chunk->cardinality <= ELEMSET_ARRAY_MAX)
+                chunk->toArray();
+        }
+        else
+        {
+            for(ElemIndex e=begin; e<chunkEnd; e++)
+                chunk->insert(low(e));
+        }
+        begin = chunkEnd;
+    }
+}
+
+void ElemSet::erase(ElemIndex elem)
+{
+    std::vector<ElemIndex>::iterator it = std::lower_bound(keys.begin(), keys.end(), key(elem));
+    if(it == keys.end() || *it != key(elem))
+        return;
+
+    size_t idx = it - keys.begin();
+    chunks[idx].erase(low(elem));
+    if(chunks[idx].cardinality == 0)
+    {
+        keys.erase(it);
+        chunks.erase(chunks.begin()+idx);
+    }
+}
+
+ElemSet ElemSet::fromWords(const quint64 *words, ElemIndex numWords)
+{
+    ElemSet r;
+    for(ElemIndex first=0; first<numWords; first+=ELEMSET_BITMAP_WORDS)
+    {
+        ElemIndex last = std::min(numWords, first+ELEMSET_BITMAP_WORDS);
+
+        Chunk c;
+        for(ElemIndex w=first; w<last; w++)
+            c.cardinality += popcount64(words[w]);
+        if(c.cardinality == 0)
+            continue;
+
+        c.bits.assign(ELEMSET_BITMAP_WORDS, 0);
+        std::copy(words+first, words+last, c.bits.begin());
+        if(c.cardinality <= ELEMSET_ARRAY_MAX)
+            c.toArray();
+
+        r.keys.push_back(first/ELEMSET_BITMAP_WORDS);
+        r.chunks.push_back(c);
+    }
+    return r;
+}
+
+void ElemSet::andWords(quint64 *words, ElemIndex numWords) const
+{
+    ElemIndex w = 0;
+    for(size_t c=0; c<keys.size() && w<numWords; c++)
+    {
+        ElemIndex first = keys[c]*ELEMSET_BITMAP_WORDS;
+        if(first >= numWords)
+            break;
+        ElemIndex last = std::min(numWords, first+ELEMSET_BITMAP_WORDS);
+
+        // Words between chunks have no members
+        std::fill(words+w, words+first, 0);
+
+        const Chunk &chunk = chunks[c];
+        if(chunk.isBitmap())
+        {
+            for(ElemIndex i=first; i<last; i++)
+                words[i] &= chunk.bits[i-first];
+        }
+        else
+        {
+            quint64 mask[ELEMSET_BITMAP_WORDS] = {0};
+            for(quint16 v : chunk.array)
+                mask[v >> 6] |= 1ULL << (v & 63);
+            for(ElemIndex i=first; i<last; i++)
+                words[i] &= mask[i-first];
+        }
+        w = last;
+    }
+    std::fill(words+w, words+numWords, 0);
+}
+
+void ElemSet::andNotWords(quint64 *words, ElemIndex numWords) const
+{
+    for(size_t c=0; c<keys.size(); c++)
+    {
+        ElemIndex first = keys[c]*ELEMSET_BITMAP_WORDS;
+        if(first >= numWords)
+            break;
+        ElemIndex last = std::min(numWords, first+ELEMSET_BITMAP_WORDS);
+
+        const Chunk &chunk = chunks[c];
+        if(chunk.isBitmap())
+        {
+            for(ElemIndex i=first; i<last; i++)
+                words[i] &= ~chunk.bits[i-first];
+        }
+        else
+        {
+            for(quint16 v : chunk.array)
+            {
+                ElemIndex i = first + (v >> 6);
+                if(i < last)
+                    words[i] &= ~(1ULL << (v & 63));
+            }
+        }
+    }
+}
+
+bool ElemSet::contains(ElemIndex elem) const
+{
+    const Chunk *chunk = findChunk(key(elem));
+    return chunk != NULL && chunk->contains(low(elem));
+}
+
+ElemSet ElemSet::operator|(const ElemSet &other) const
+{
+    ElemSet r;
+    size_t i = 0, j = 0;
+    while(i < keys.size() || j < other.keys.size())
+    {
+        if(j == other.keys.size() || (i < keys.size() && keys[i] < other.keys[j]))
+        {
+            r.keys.push_back(keys[i]);
+            r.chunks.push_back(chunks[i++]);
+        }
+        else if(i == keys.size() || other.keys[j] < keys[i])
+        {
+            r.keys.push_back(other.keys[j]);
+            r.chunks.push_back(other.chunks[j++]);
+        }
+        else
+        {
+            r.keys.push_back(keys[i]);
+            r.chunks.push_back(unite(chunks[i++], other.chunks[j++]));
+        }
+    }
+    return r;
+}
+
+ElemSet ElemSet::operator&(const ElemSet &other) const
+{
+    ElemSet r;
+    size_t i = 0, j = 0;
+    while(i < keys.size() && j < other.keys.size())
+    {
+        if(keys[i] < other.keys[j])
+            i++;
+        else if(other.keys[j] < keys[i])
+            j++;
+        else
+        {
+            Chunk c = intersect(chunks[i++], other.chunks[j++]);
+            if(c.cardinality > 0)
+            {
+                r.keys.push_back(keys[i-1]);
+                r.chunks.push_back(c);
+            }
+        }
+    }
+    return r;
+}
+
+ElemSet ElemSet::operator-(const ElemSet &other) const
+{
+    ElemSet r;
+    size_t j = 0;
+    for(size_t i=0; i<keys.size(); i++)
+    {
+        while(j < other.keys.size() && other.keys[j] < keys[i])
+            j++;
+
+        if(j < other.keys.size() && other.keys[j] == keys[i])
+        {
+            Chunk c = subtract(chunks[i], other.chunks[j]);
+            if(c.cardinality > 0)
+            {
+                r.keys.push_back(keys[i]);
+                r.chunks.push_back(c);
+            }
+        }
+        else
+        {
+            r.keys.push_back(keys[i]);
+            r.chunks.push_back(chunks[i]);
+        }
+    }
+    return r;
+}
+
+bool ElemSet::operator==(const ElemSet &other) const
+{
+    if(keys != other.keys)
+        return false;
+    for(size_t c=0; c<chunks.size(); c++)
+    {
+        const Chunk &a = chunks[c];
+        const Chunk &b = other.chunks[c];
+        if(a.cardinality != b.cardinality || a.isBitmap() != b.isBitmap())
+            return false;
+        if(a.isBitmap() ? a.bits != b.bits : a.array != b.array)
+            return false;
+    }
+    return true;
+}
+
+// const_iterator
+
+void ElemSet::const_iterator::settle()
+{
+    // Move (chunk,pos) onto the next member, or onto end()
+    while(chunk < set->keys.size())
+    {
+        const Chunk &c = set->chunks[chunk];
+        if(!c.isBitmap())
+        {
+            if(pos < (int)c.array.size())
+                return;
+        }
+        else
+        {
+            while(pos < ELEMSET_BITMAP_WORDS*64)
+            {
+                quint64 word = c.bits[pos >> 6] >> (pos & 63);
+                if(word)
+                {
+                    pos += __builtin_ctzll(word);
+                    return;
+                }
+                pos = ((pos >> 6) + 1) << 6;
+            }
+        }
+        chunk++;
+        pos = 0;
+    }
+}
+
+ElemIndex ElemSet::const_iterator::operator*() const
+{
+    const Chunk &c = set->chunks[chunk];
+    ElemIndex base = set->keys[chunk] << 16;
+    return base + (c.isBitmap() ? pos : c.array[pos]);
+}
@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef ELEMSET_H
+#define ELEMSET_H
+
+#include <QtGlobal>
+
+#include <cstddef>
+#include <vector>
+
+typedef unsigned long long ElemIndex;
+
+// Compressed bitmap of element indices (roaring-style). Indices are
+// grouped by their upper bits into chunks of 65536; a chunk holds a
+// sorted array of 16-bit offsets while sparse and switches to a plain
+// 65536-bit bitmap once it has more than ELEMSET_ARRAY_MAX members.
+// Union, intersection and difference work a chunk (or word) at a time.
+#define ELEMSET_ARRAY_MAX 4096
+#define ELEMSET_BITMAP_WORDS 1024
+
+class ElemSet
+{
+public:
+    ElemSet() {}
+
+    bool empty() const { return keys.empty(); }
+    ElemIndex size() const;
+    void clear();
+
+    void insert(ElemIndex elem);
+    void insertRange(ElemIndex begin, ElemIndex end); // [begin,end)
+    void erase(ElemIndex elem);
+    bool contains(ElemIndex elem) const;
+    ElemIndex count(ElemIndex elem) const { return contains(elem) ? 1 : 0; }
+
+    ElemSet operator|(const ElemSet &other) const;
+    ElemSet operator&(const ElemSet &other) const;
+    ElemSet operator-(const ElemSet &other) const;
+    ElemSet &operator|=(const ElemSet &other) { *this = *this | other; return *this; }
+    ElemSet &operator&=(const ElemSet &other) { *this = *this & other; return *this; }
+    ElemSet &operator-=(const ElemSet &other) { *this = *this - other; return *this; }
+    bool operator==(const ElemSet &other) const;
+    bool operator!=(const ElemSet &other) const { return !(*this == other); }
+
+    // Set of the bits set in a dense little-endian bitmap of numWords words
+    static ElemSet fromWords(const quint64 *words, ElemIndex numWords);
+
+    // Clear the bits of a dense bitmap outside (andWords) or inside
+    // (andNotWords) this set, a chunk of words at a time
+    void andWords(quint64 *words, ElemIndex numWords) const;
+    void andNotWords(quint64 *words, ElemIndex numWords) const;
+
+    // Calls fn(elem) for every member in ascending order
+    template<typename Fn> void forEach(Fn fn) const;
+
+    class const_iterator
+    {
+    public:
+        const_iterator() : set(NULL), chunk(0), pos(0) {}
+        const_iterator(const ElemSet *s, size_t c) : set(s), chunk(c), pos(0) { settle(); }
+
+        ElemIndex operator*() const;
+        const_iterator &operator++() { pos++; settle(); return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++(*this); return it; }
+        bool operator==(const const_iterator &o) const { return chunk == o.chunk && pos == o.pos; }
+        bool operator!=(const const_iterator &o) const { return !(*this == o); }
+
+    private:
+        void settle();
+
+        const ElemSet *set;
+        size_t chunk;
+        int pos; // array position, or bit position in a bitmap chunk
+    };
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, keys.size()); }
+
+private:
+    struct Chunk
+    {
+        Chunk() : cardinality(0) {}
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(quint16 low) const;
+        void insert(quint16 low);
+        void erase(quint16 low);
+        void toBitmap();
+        void toArray();
+
+        std::vector<quint16> array; // sorted, used while !isBitmap()
+        std::vector<quint64> bits;  // ELEMSET_BITMAP_WORDS words when bitmap
+        int cardinality;
+    };
+
+    static ElemIndex key(ElemIndex elem) { return elem >> 16; }
+    static quint16 low(ElemIndex elem) { return (quint16)(elem & 0xFFFF); }
+
+    static Chunk unite(const Chunk &a, const Chunk &b);
+    static Chunk intersect(const Chunk &a, const Chunk &b);
+    static Chunk subtract(const Chunk &a, const Chunk &b);
+
+    Chunk *findChunk(ElemIndex k, bool create);
+    const Chunk *findChunk(ElemIndex k) const;
+
+    std::vector<ElemIndex> keys; // sorted, one per non-empty chunk
+    std::vector<Chunk> chunks;
+};
+
+template<typename Fn> void ElemSet::forEach(Fn fn) const
+{
+    for(size_t c=0; c<keys.size(); c++)
+    {
+        ElemIndex base = keys[c] << 16;
+        const Chunk &chunk = chunks[c];
+        if(chunk.isBitmap())
+        {
+            for(int w=0; w<ELEMSET_BITMAP_WORDS; w++)
+            {
+                quint64 word = chunk.bits[w];
+                while(word)
+                {
+                    int bit = __builtin_ctzll(word);
+                    fn(base + w*64 + bit);
+                    word &= word-1;
+                }
+            }
+        }
+        else
+        {
+            for(quint16 v : chunk.array)
+                fn(base + v);
+        }
+    }
+}
+
+#endif // ELEMSET_H
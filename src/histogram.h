@@ -0,0 +1,156 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include <algorithm>
+#include <vector>
+
+#include "parallel.h"
+#include "sampletable.h"
+
+// Rows classified at a time before their axes are binned
+#define HIST_BLOCK_SIZE 256
+
+// Maps values of one axis onto numBins equal-width bins over [min,max];
+// values outside the range fall into the first or last bin
+struct AxisBinning
+{
+    AxisBinning() : min(0), factor(0), numBins(1) {}
+    AxisBinning(qreal vmin, qreal vmax, int bins)
+        : min(vmin), factor(vmax > vmin ? bins/(vmax-vmin) : 0), numBins(bins) {}
+
+    int bin(qreal val) const
+    {
+        int b = (int)((val-min)*factor);
+        return std::max(0, std::min(b, numBins-1));
+    }
+
+    qreal min;
+    qreal factor;
+    int numBins;
+};
+
+// Per-axis histograms of the visible samples and, side by side, of the
+// selected ones, so selected and total distributions can be overlaid
+struct SampleHistograms
+{
+    SampleHistograms();
+
+    int numBins;
+    QVector<quint32> visible;  // [axis*numBins + bin]
+    QVector<quint32> selected; // [axis*numBins + bin]
+    quint32 maxVisible[NUM_SAMPLE_AXES];
+    quint32 maxSelected[NUM_SAMPLE_AXES];
+
+    quint32 visibleAt(int axis, int bin) const { return visible[axis*numBins+bin]; }
+    quint32 selectedAt(int axis, int bin) const { return selected[axis*numBins+bin]; }
+
+    void reset(int bins);
+    void merge(const SampleHistograms &other);
+    void updateMaxes();
+};
+
+// Bins every axis of all samples in one pass. isVisible(elem) and
+// isSelected(elem) classify each sample; worker threads fill their own
+// histograms, which are merged at the end. mins and maxes hold the
+// range of each of the NUM_SAMPLE_AXES axes.
+template <typename VisibleFn, typename SelectedFn>
+void calcHistograms(const SampleTable &samples, const qreal *mins, const qreal *maxes, int numBins,
+                    VisibleFn isVisible, SelectedFn isSelected, SampleHistograms &hists)
+{
+    AxisBinning binning[NUM_SAMPLE_AXES];
+    for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+        binning[axis] = AxisBinning(mins[axis], maxes[axis], numBins);
+
+    ElemIndex numSamples = samples.size();
+    long long numBlocks = (numSamples + HIST_BLOCK_SIZE - 1) / HIST_BLOCK_SIZE;
+    std::vector<SampleHistograms> workerHists(std::max(1, std::min(numWorkerThreads(), (int)std::max(1LL, numBlocks))));
+
+    parallelChunks(numBlocks, (int)workerHists.size(), [&](int w, long long begin, long long end)
+    {
+        SampleHistograms &local = workerHists[w];
+        local.reset(numBins);
+        quint32 *vis = local.visible.data();
+        quint32 *sel = local.selected.data();
+
+        ElemIndex rows[HIST_BLOCK_SIZE];
+        bool rowSelected[HIST_BLOCK_SIZE];
+
+        for(long long block=begin; block<end; block++)
+        {
+            ElemIndex first = block*HIST_BLOCK_SIZE;
+            ElemIndex last = std::min(first + HIST_BLOCK_SIZE, numSamples);
+
+            int n = 0;
+            for(ElemIndex elem=first; elem<last; elem++)
+            {
+                if(!isVisible(elem))
+                    continue;
+                rows[n] = elem;
+                rowSelected[n] = isSelected(elem);
+                n++;
+            }
+
+            for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+            {
+                const long long *vals = samples.column(axis);
+                const AxisBinning &b = binning[axis];
+                quint32 *axisVis = vis + axis*numBins;
+                quint32 *axisSel = sel + axis*numBins;
+                for(int i=0; i<n; i++)
+                {
+                    int bin = b.bin(vals[rows[i]]);
+                    axisVis[bin]++;
+                    if(rowSelected[i])
+                        axisSel[bin]++;
+                }
+            }
+        }
+    });
+
+    hists.reset(numBins);
+    for(unsigned int w=0; w<workerHists.size(); w++)
+        hists.merge(workerHists[w]);
+    hists.updateMaxes();
+}
+
+#endif // HISTOGRAM_H
@@ -41,6 +41,81 @@
 #include <iostream>
 using namespace std;
 
+void ComponentTable::build(Node *node)
+{
+    clear();
+    if(node == NULL)
+        return;
+
+    int maxTopoDepth = node->GetTopoTreeDepth()+1;
+    for(int depth=0; depth<maxTopoDepth; depth++)
+    {
+        depthOffsets.push_back(rows.size());
+
+        vector<Component*> componentsAtDepth;
+        node->GetComponentsNLevelsDeeper(&componentsAtDepth, depth);
+        for(Component *c : componentsAtDepth)
+        {
+            ComponentAggregate row;
+            row.component = c;
+            row.depth = depth;
+            row.parent = indexOf(c->GetParent());
+            row.selSamples = 0;
+            row.selCycles = 0;
+            row.transactions = 0;
+
+            indices.insert(c, rows.size());
+            rows.push_back(row);
+        }
+    }
+    depthOffsets.push_back(rows.size());
+
+    rowSampleSets.resize(rows.size());
+}
+
+void ComponentTable::bindSampleSets()
+{
+    for(size_t r=0; r<rows.size(); r++)
+    {
+        Component *c = rows[r].component;
+        int direction = (c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD) ?
+                        SYS_SAGE_DATAPATH_INCOMING : SYS_SAGE_DATAPATH_OUTGOING;
+
+        vector<DataPath*> dp_vec;
+        c->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, direction);
+
+        rowSampleSets[r].clear();
+        for(DataPath *dp : dp_vec)
+            rowSampleSets[r].push_back((SampleSet*)dp->attrib["sample_set"]);
+    }
+}
+
+void ComponentTable::refresh()
+{
+    // Each sample is on exactly one DataPath, so the sets of a component
+    // are disjoint and their sizes add up
+    for(size_t r=0; r<rows.size(); r++)
+    {
+        ComponentAggregate &row = rows[r];
+        row.selSamples = 0;
+        row.selCycles = 0;
+        for(SampleSet *ss : rowSampleSets[r])
+        {
+            row.selSamples += ss->selSamples.size();
+            row.selCycles += ss->selCycles;
+        }
+        row.transactions = *(int*)row.component->attrib["transactions"];
+    }
+}
+
+void ComponentTable::clear()
+{
+    rows.clear();
+    depthOffsets.clear();
+    rowSampleSets.clear();
+    indices.clear();
+}
+
 // hwNode::hwNode()
 // {
 // }
@@ -42,15 +42,15 @@
 #include <QFile>
 #include <QXmlStreamReader>
 #include <QMap>
+#include <QHash>
 
 #include <vector>
 
-#include "dataobject.h"
+#include "elemset.h"
 
-class DataObject;
+#include "sys-sage.hpp"
 
-typedef unsigned long long ElemIndex;
-typedef std::set<ElemIndex> ElemSet;
+class DataObject;
 
 struct SampleSet
 {
@@ -60,6 +60,48 @@ struct SampleSet
     ElemSet selSamples;
 };
 
+// Selection totals of one hardware component over the sample DataPaths
+// the topology view shows for it (incoming for threads, outgoing otherwise)
+struct ComponentAggregate
+{
+    Component *component;
+    int depth;
+    int parent; // row of the parent component, -1 for the root
+    qlonglong selSamples;
+    qlonglong selCycles;
+    int transactions;
+};
+
+// Flat table of all topology components, laid out by depth and left to
+// right within a depth (the order of GetComponentsNLevelsDeeper). Rows
+// stay valid until the topology is reloaded; the totals are refreshed
+// once per selection change, so views read them as plain arrays.
+class ComponentTable
+{
+public:
+    // Rows and depth layout, once per loaded topology
+    void build(Node *node);
+    // Sample sets of each row, once the samples are bound to the topology
+    void bindSampleSets();
+    // Selection totals from the current sample sets
+    void refresh();
+    void clear();
+
+    int size() const { return (int)rows.size(); }
+    int numDepths() const { return depthOffsets.empty() ? 0 : (int)depthOffsets.size()-1; }
+    int depthBegin(int depth) const { return depthOffsets[depth]; }
+    int depthEnd(int depth) const { return depthOffsets[depth+1]; }
+
+    const ComponentAggregate &at(int row) const { return rows[row]; }
+    int indexOf(Component *c) const { return indices.value(c, -1); }
+
+private:
+    std::vector<ComponentAggregate> rows;
+    std::vector<int> depthOffsets; // rows of depth d: [depthOffsets[d], depthOffsets[d+1])
+    std::vector<std::vector<SampleSet*> > rowSampleSets;
+    QHash<Component*,int> indices;
+};
+
 // class hwNode
 // {
 // public:
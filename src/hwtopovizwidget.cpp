@@ -40,6 +40,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -49,6 +50,10 @@ HWTopoVizWidget::HWTopoVizWidget(QWidget *parent) :
     dataMode = COLORBY_CYCLES;
     vizMode = SUNBURST;
 
+    needsLayout = false;
+    needsConstructNodeBoxes = false;
+    needsCalcMinMaxes = false;
+
     colorMap = gradientColorMap(QColor(255,237,160),
                                 QColor(240,59 ,32 ),
                                 256);
@@ -67,11 +72,15 @@ void HWTopoVizWidget::frameUpdate()
         calcMinMaxes();
         needsCalcMinMaxes = false;
     }
+    if(needsLayout)
+    {
+        constructLayout(drawBox);
+        needsLayout = false;
+        needsConstructNodeBoxes = true;
+    }
     if(needsConstructNodeBoxes)
     {
-        constructNodeBoxes(drawBox,
-                           dataSet->node,
-                           depthValRanges,
+        constructNodeBoxes(depthValRanges,
                            depthTransRanges,
                            dataMode,
                            nodeBoxes,linkBoxes);
@@ -91,24 +100,23 @@ void HWTopoVizWidget::processData()
     if(dataSet->node == NULL)
         return;
 
-    //TODO at the moment for one CPU
-    Node* node = (Node*)dataSet->node;
-    //Chip* cpu = (Chip*)dataSet->node->GetChild(1);
-    int maxTopoDepth = node->GetTopoTreeDepth()+1;
+    const ComponentTable &table = dataSet->components();
+    int maxTopoDepth = table.numDepths();
     qDebug("Node Topology Depth: %d ", maxTopoDepth);
 
     depthRange = IntRange(0,maxTopoDepth);
+    widthRange.clear();
     for(int i=depthRange.first; i<(int)depthRange.second; i++)
     {
-        vector<Component*> componentsAtDepth;
-        node->GetComponentsNLevelsDeeper(&componentsAtDepth, i);
-        IntRange wr(0,componentsAtDepth.size());
+        IntRange wr(table.depthBegin(i),table.depthEnd(i));
         widthRange.push_back(wr);
     }
 
     processed = true;
 
+    needsLayout = true;
     needsCalcMinMaxes = true;
+    requestFrame();
 }
 
 void HWTopoVizWidget::selectionChangedSlot()
@@ -117,6 +125,7 @@ void HWTopoVizWidget::selectionChangedSlot()
         return;
 
     needsCalcMinMaxes = true;
+    requestFrame();
 }
 
 void HWTopoVizWidget::visibilityChangedSlot()
@@ -125,9 +134,10 @@ void HWTopoVizWidget::visibilityChangedSlot()
         return;
 
     needsCalcMinMaxes = true;
+    requestFrame();
 }
 
-void HWTopoVizWidget::drawTopo(QPainter *painter, QRectF rect, ColorMap &cm, QVector<NodeBox> &nb, QVector<LinkBox> &lb)
+void HWTopoVizWidget::drawTopo(QPainter *painter, ColorMap &cm, QVector<NodeBox> &nb, QVector<LinkBox> &lb)
 {
     // Draw node outlines
     painter->setPen(QPen(Qt::black));
@@ -144,8 +154,7 @@ void HWTopoVizWidget::drawTopo(QPainter *painter, QRectF rect, ColorMap &cm, QVe
         // Draw rect (radial or regular)
         if(vizMode == SUNBURST)
         {
-            QVector<QPointF> segmentPoly = rectToRadialSegment(box,rect);
-            painter->drawPolygon(segmentPoly.constData(),segmentPoly.size());
+            painter->drawPolygon(nodePolys.at(b));
         }
         else if(vizMode == ICICLE)
         {
@@ -164,8 +173,7 @@ void HWTopoVizWidget::drawTopo(QPainter *painter, QRectF rect, ColorMap &cm, QVe
 
         if(vizMode == SUNBURST)
         {
-            QVector<QPointF> segmentPoly = rectToRadialSegment(box,rect);
-            painter->drawPolygon(segmentPoly.constData(),segmentPoly.size());
+            painter->drawPolygon(linkPolys.at(b));
         }
         else if(vizMode == ICICLE)
         {
@@ -179,10 +187,7 @@ void HWTopoVizWidget::drawQtPainter(QPainter *painter)
     if(!processed)
         return;
 
-    QRectF drawBox = this->rect();
-    drawBox.adjust(margin,margin,-margin,-margin);
-
-    drawTopo(painter,drawBox,colorMap,nodeBoxes,linkBoxes);
+    drawTopo(painter,colorMap,nodeBoxes,linkBoxes);
 
 }
 
@@ -191,11 +196,11 @@ void HWTopoVizWidget::mousePressEvent(QMouseEvent *e)
     if(!processed)
         return;
 
-    Component *c = nodeAtPosition(e->pos());
+    int b = nodeAtPosition(e->pos());
 
-    if(c)
+    if(b != -1)
     {
-        selectSamplesWithinNode(c);
+        selectSamplesWithinNode(nodeBoxes[b].component);
     }
 
 }
@@ -205,10 +210,11 @@ void HWTopoVizWidget::mouseMoveEvent(QMouseEvent* e)
     if(!processed)
         return;
 
-    Component *c = nodeAtPosition(e->pos());
+    int b = nodeAtPosition(e->pos());
 
-    if(c)
+    if(b != -1)
     {
+        Component *c = nodeBoxes[b].component;
         QString label = QString::fromStdString(c->GetName());
         if(c->GetComponentType() == SYS_SAGE_COMPONENT_CACHE)
             label += "L" + QString::number(((Cache*)c)->GetCacheLevel());
@@ -220,26 +226,9 @@ void HWTopoVizWidget::mouseMoveEvent(QMouseEvent* e)
 
         label += "\n";
 
-        int numCycles = 0;
-        int numSamples = 0;
-        //QMap<DataObject*,SampleSet>*sampleSets = (QMap<DataObject*,SampleSet>*)c->attrib["sampleSets"];
-        // numSamples += (*sampleSets)[dataSet].selSamples.size();
-        // numCycles += (*sampleSets)[dataSet].selCycles;
-
-        int direction;
-        if(c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD)
-        {
-            direction = SYS_SAGE_DATAPATH_INCOMING;
-        }else {
-            direction = SYS_SAGE_DATAPATH_OUTGOING;
-        }
-        vector<DataPath*> dp_vec;
-        c->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, direction);
-        for(DataPath* dp : dp_vec) {
-            SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
-            numSamples += ss->selSamples.size();
-            numCycles += ss->selCycles;
-        }
+        const ComponentAggregate &agg = dataSet->components().at(nodeBoxes[b].index);
+        qlonglong numCycles = agg.selCycles;
+        qlonglong numSamples = agg.selSamples;
 
         label += "Samples: " + QString::number(numSamples) + "\n";
         label += "Cycles: " + QString::number(numCycles) + "\n";
@@ -262,8 +251,8 @@ void HWTopoVizWidget::resizeEvent(QResizeEvent *e)
     if(!processed)
         return;
 
-    needsConstructNodeBoxes = true;
-    frameUpdate();
+    needsLayout = true;
+    requestFrame();
 }
 
 void HWTopoVizWidget::calcMinMaxes()
@@ -278,46 +267,22 @@ void HWTopoVizWidget::calcMinMaxes()
     depthTransRanges.resize(depthRange.second - depthRange.first);
     depthTransRanges.fill(limits);
 
-    Node* node = dataSet->node;
+    // Totals come from the component table, refreshed with the selection
+    const ComponentTable &table = dataSet->components();
     for(int r=0, i=depthRange.first; i<depthRange.second; r++, i++)
     {
-        vector<Component*> componentsAtDepth;
-        node->GetComponentsNLevelsDeeper(&componentsAtDepth, i);
         // Get min/max for this row
         for(int j=widthRange[r].first; j<widthRange[r].second; j++)
         {
-            Component * c = componentsAtDepth[j];
-            // QMap<DataObject*,SampleSet>*sampleSets = (QMap<DataObject*,SampleSet>*)c->attrib["sampleSets"];
-            // if(!sampleSets->contains(dataSet) )
-            //     continue;
-            // ElemSet &samples = (*sampleSets)[dataSet].selSamples;
-            // int numCycles = (*sampleSets)[dataSet].selCycles;
-
-            ElemSet samples;
-            int numCycles = 0;
-            int direction;
-            if(c->GetComponentType() == SYS_SAGE_COMPONENT_THREAD)
-            {
-                direction = SYS_SAGE_DATAPATH_INCOMING;
-            }else {
-                direction = SYS_SAGE_DATAPATH_OUTGOING;
-            }
-            vector<DataPath*> dp_vec;
-            c->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, direction);
-            for(DataPath* dp : dp_vec) {
-                SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
-                samples.insert(ss->selSamples.begin(),ss->selSamples.end());
-                numCycles += ss->selCycles;
-            }
-
+            const ComponentAggregate &agg = table.at(j);
 
-            qreal val = (dataMode == COLORBY_CYCLES) ? numCycles : samples.size();
+            qreal val = (dataMode == COLORBY_CYCLES) ? agg.selCycles : agg.selSamples;
             //val = (qreal)(*numCycles) / (qreal)samples->size();
 
             depthValRanges[i].first=0;//min(depthValRanges[i].first,val);
             depthValRanges[i].second=max(depthValRanges[i].second,val);
 
-            qreal trans = *(int*)(c->attrib["transactions"]);
+            qreal trans = agg.transactions;
             depthTransRanges[i].first=0;//min(depthTransRanges[i].first,trans);
             depthTransRanges[i].second=max(depthTransRanges[i].second,trans);
         }
@@ -327,26 +292,23 @@ void HWTopoVizWidget::calcMinMaxes()
     needsRepaint = true;
 }
 
-void HWTopoVizWidget::constructNodeBoxes(QRectF rect,
-                                    Node *node,
-                                    QVector<RealRange> &valRanges,
-                                    QVector<RealRange> &transRanges,
-                                    DataMode m,
-                                    QVector<NodeBox> &nbout,
-                                    QVector<LinkBox> &lbout)
+void HWTopoVizWidget::constructLayout(QRectF rect)
 {
-    nbout.clear();
-    lbout.clear();
+    layoutRect = rect;
+    nodeBoxes.clear();
+    nodePolys.clear();
+    linkSlots.clear();
+    depthEdges.clear();
+    cellLefts.clear();
 
-    if(node == NULL)
+    if(dataSet->node == NULL)
         return;
 
     float nodeMarginX = 2.0f;
     float nodeMarginY = 10.0f;
 
-    //TODO at the moment for one CPU
-    // Chip* cpu = (Chip*)node->GetChild(1);
-    int maxTopoDepth = node->GetTopoTreeDepth()+1;
+    const ComponentTable &table = dataSet->components();
+    int maxTopoDepth = table.numDepths();
 
     float deltaX = 0;
     float deltaY = rect.height() / maxTopoDepth;
@@ -354,110 +316,120 @@ void HWTopoVizWidget::constructNodeBoxes(QRectF rect,
     // Adjust boxes to fill the rect space
     for(int i=0; i<maxTopoDepth; i++)
     {
-        vector<Component*> componentsAtDepth;
-        node->GetComponentsNLevelsDeeper(&componentsAtDepth, i);
-        deltaX = rect.width() / (float)componentsAtDepth.size();
-        for(int j=0; j<componentsAtDepth.size(); j++)
+        depthEdges.push_back(rect.top()+i*deltaY);
+
+        int begin = table.depthBegin(i);
+        int width = table.depthEnd(i) - begin;
+        deltaX = rect.width() / (float)width;
+        for(int j=0; j<width; j++)
         {
             // Create Node Box
             NodeBox nb;
-            nb.component = componentsAtDepth[j];
+            nb.component = table.at(begin+j).component;
+            nb.index = begin+j;
             nb.box.setRect(rect.left()+j*deltaX,
                            rect.top()+i*deltaY,
                            deltaX,
                            deltaY);
-
-            // Get value by cycles or samples
-            int numCycles = 0;
-            int numSamples = 0;
-            // QMap<DataObject*,SampleSet>* sampleSets = (QMap<DataObject*,SampleSet>*)nb.component->attrib["sampleSets"];
-            // numSamples += (*sampleSets)[dataSet].selSamples.size();
-            // numCycles += (*sampleSets)[dataSet].selCycles;
-            int direction;
-            if(nb.component->GetComponentType() == SYS_SAGE_COMPONENT_THREAD){
-                direction = SYS_SAGE_DATAPATH_INCOMING;
-            }else {
-                direction = SYS_SAGE_DATAPATH_OUTGOING;
-            }
-            vector<DataPath*> dp_vec;
-            nb.component->GetAllDpByType(&dp_vec, SYS_SAGE_MITOS_SAMPLE, direction);
-            for(DataPath* dp : dp_vec) {
-                SampleSet *ss = (SampleSet*)dp->attrib["sample_set"];
-                numSamples += ss->selSamples.size();
-                numCycles += ss->selCycles;
-            }
-
-            qreal unscaledval = (m == COLORBY_CYCLES) ? numCycles : numSamples;
-            nb.val = scale(unscaledval,
-                           valRanges.at(i).first,
-                           valRanges.at(i).second,
-                           0, 1);
+            cellLefts.push_back(nb.box.left());
 
             if(i==0)
                 nb.box.adjust(0,0,0,-nodeMarginY);
             else
                 nb.box.adjust(nodeMarginX,nodeMarginY,-nodeMarginX,-nodeMarginY);
 
-            nbout.push_back(nb);
+            nodeBoxes.push_back(nb);
+            nodePolys.push_back(QPolygonF(rectToRadialSegment(nb.box,rect)));
 
-            // Create Link Box
+            // Create Link Box slot
             if(i-1 >= 0)
             {
-                LinkBox lb;
-                lb.parent = nb.component->GetParent();
-                lb.child = nb.component;
-
-                // scale width by transactions
-                lb.box.setRect(rect.left()+j*deltaX,
-                               rect.top()+i*deltaY,
-                               deltaX,
-                               nodeMarginY);
-
-                lb.box.adjust(nodeMarginX,-nodeMarginY,-nodeMarginX,0);
-
-                float linkWidth = scale(*(int*)(nb.component->attrib["transactions"]),
-                                        transRanges.at(i).first,
-                                        transRanges.at(i).second,
-                                        1.0f,
-                                        lb.box.width());
-                float deltaWidth = (lb.box.width()-linkWidth)/2.0f;
-
-                lb.box.adjust(deltaWidth,0,-deltaWidth,0);
-
-                lbout.push_back(lb);
+                QRectF slot(rect.left()+j*deltaX,
+                            rect.top()+i*deltaY,
+                            deltaX,
+                            nodeMarginY);
+                slot.adjust(nodeMarginX,-nodeMarginY,-nodeMarginX,0);
+                linkSlots.push_back(slot);
             }
         }
     }
+    depthEdges.push_back(rect.bottom());
 
     needsRepaint = true;
 }
 
-Component *HWTopoVizWidget::nodeAtPosition(QPoint p)
+void HWTopoVizWidget::constructNodeBoxes(QVector<RealRange> &valRanges,
+                                    QVector<RealRange> &transRanges,
+                                    DataMode m,
+                                    QVector<NodeBox> &nbout,
+                                    QVector<LinkBox> &lbout)
 {
-    QRectF drawBox = this->rect();
-    drawBox.adjust(margin,margin,-margin,-margin);
+    lbout.clear();
+    linkPolys.clear();
 
-    for(int b=0; b<nodeBoxes.size(); b++)
+    const ComponentTable &table = dataSet->components();
+    int link = 0;
+    for(int b=0; b<nbout.size(); b++)
     {
-        Component *c = nodeBoxes[b].component;
-        QRectF box = nodeBoxes[b].box;
-
-        bool containsP = false;
-        if(vizMode == SUNBURST)
-        {
-            QPointF radp = reverseRadialTransform(p,drawBox);
-            containsP = box.contains(radp);
-        }
-        else if(vizMode == ICICLE)
+        NodeBox &nb = nbout[b];
+        const ComponentAggregate &agg = table.at(nb.index);
+        int i = agg.depth;
+
+        // Get value by cycles or samples
+        qreal unscaledval = (m == COLORBY_CYCLES) ? agg.selCycles : agg.selSamples;
+        nb.val = scale(unscaledval,
+                       valRanges.at(i).first,
+                       valRanges.at(i).second,
+                       0, 1);
+
+        // Create Link Box
+        if(i-1 >= 0)
         {
-            containsP = box.contains(p);
+            LinkBox lb;
+            lb.parent = nb.component->GetParent();
+            lb.child = nb.component;
+            lb.box = linkSlots.at(link++);
+
+            // scale width by transactions
+            float linkWidth = scale(agg.transactions,
+                                    transRanges.at(i).first,
+                                    transRanges.at(i).second,
+                                    1.0f,
+                                    lb.box.width());
+            float deltaWidth = (lb.box.width()-linkWidth)/2.0f;
+
+            lb.box.adjust(deltaWidth,0,-deltaWidth,0);
+
+            lbout.push_back(lb);
+            linkPolys.push_back(QPolygonF(rectToRadialSegment(lb.box,layoutRect)));
         }
-
-        if(containsP)
-            return c;
     }
 
-    return NULL;
+    needsRepaint = true;
+}
+
+int HWTopoVizWidget::nodeAtPosition(QPoint p)
+{
+    if(depthEdges.isEmpty())
+        return -1;
+
+    QPointF lp = p;
+    if(vizMode == SUNBURST)
+        lp = reverseRadialTransform(p,layoutRect);
+
+    // Depth from the row edges, then the cell within that depth
+    const qreal *edges = depthEdges.constData();
+    int depth = upper_bound(edges, edges+depthEdges.size(), lp.y()) - edges - 1;
+    if(depth < 0 || depth >= depthEdges.size()-1)
+        return -1;
+
+    const ComponentTable &table = dataSet->components();
+    const qreal *lefts = cellLefts.constData();
+    int b = upper_bound(lefts+table.depthBegin(depth), lefts+table.depthEnd(depth), lp.x()) - lefts - 1;
+    if(b < table.depthBegin(depth) || !nodeBoxes[b].box.contains(lp))
+        return -1;
+
+    return b;
 }
 
 void HWTopoVizWidget::selectSamplesWithinNode(Component *c)
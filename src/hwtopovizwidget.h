@@ -44,6 +44,7 @@
 
 #include <QMouseEvent>
 #include <QPair>
+#include <QPolygonF>
 #include <QXmlStreamReader>
 #include <QToolTip>
 
@@ -64,9 +65,10 @@ struct NodeBox
     NodeBox() {memset(this,0,sizeof(*this));}
     NodeBox(Component* c,
             QRectF b)
-            : component(c),box(b) {}
+            : component(c),index(-1),box(b) {}
 
     Component* component;
+    int index; // row in the DataObject's component table
     QRectF box;
     qreal val;
 };
@@ -107,7 +109,7 @@ protected:
     void processData();
     void selectionChangedSlot();
     void visibilityChangedSlot();
-    void drawTopo(QPainter *painter, QRectF rect, ColorMap &cm, QVector<NodeBox> &nb, QVector<LinkBox> &lb);
+    void drawTopo(QPainter *painter, ColorMap &cm, QVector<NodeBox> &nb, QVector<LinkBox> &lb);
     void drawQtPainter(QPainter *painter);
 
 signals:
@@ -124,22 +126,34 @@ public slots:
 
 private:
     void calcMinMaxes();
-    void constructNodeBoxes(QRectF rect,
-                            Node *node,
-                            QVector<RealRange> &valRanges,
+    void constructLayout(QRectF rect);
+    void constructNodeBoxes(QVector<RealRange> &valRanges,
                             QVector<RealRange> &transRanges, DataMode m,
                             QVector<NodeBox> &nbout,
                             QVector<LinkBox> &lbout);
-    Component* nodeAtPosition(QPoint p);
+    int nodeAtPosition(QPoint p);
     void selectSamplesWithinNode(Component *lvl);
 
 private:
 
+    bool needsLayout;
     bool needsConstructNodeBoxes;
     bool needsCalcMinMaxes;
 
     QVector<NodeBox> nodeBoxes;
     QVector<LinkBox> linkBoxes;
+
+    // Layout geometry, rebuilt only on resize or a new topology. Node
+    // boxes are in component table order; link slots are the full-width
+    // link boxes before scaling by transactions.
+    QRectF layoutRect;
+    QVector<QPolygonF> nodePolys;
+    QVector<QRectF> linkSlots;
+    QVector<QPolygonF> linkPolys;
+
+    // Hit-test index: row edges by depth, cell left edges by node box
+    QVector<qreal> depthEdges;
+    QVector<qreal> cellLefts;
     QVector<RealRange> depthValRanges;
     QVector<RealRange> depthTransRanges;
 
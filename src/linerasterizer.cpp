@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+#include "linerasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+LineRasterizer::LineRasterizer()
+{
+    w = 0;
+    h = 0;
+}
+
+void LineRasterizer::resize(int width, int height)
+{
+    w = std::max(width, 0);
+    h = std::max(height, 0);
+    clear();
+}
+
+void LineRasterizer::clear()
+{
+    accum.assign((size_t)w*h*4, 0.0f);
+    batches.clear();
+}
+
+void LineRasterizer::addBatch(float xa, float xb, const quint16 *ya, const quint16 *yb,
+                              const quint8 *labels, const float *palette, size_t numLines)
+{
+    if(numLines == 0 || w == 0 || h == 0)
+        return;
+
+    float xmin = std::min(xa, xb);
+    float xmax = std::max(xa, xb);
+
+    Batch batch;
+    batch.xa = xa;
+    batch.xb = xb;
+    batch.ya = ya;
+    batch.yb = yb;
+    batch.labels = labels;
+    batch.palette = palette;
+    batch.numLines = numLines;
+    batch.firstCol = (int)floorf(xmin*(w-1) + 0.5f);
+    batch.lastCol = (int)floorf(xmax*(w-1) + 0.5f);
+    batches.push_back(batch);
+}
+
+void LineRasterizer::rasterize()
+{
+    if(w == 0 || h == 0)
+        return;
+
+    int numTiles = (w + RASTER_TILE_WIDTH - 1) / RASTER_TILE_WIDTH;
+    parallelChunks(numTiles, [&](int, long long begin, long long end)
+    {
+        for(long long t=begin; t<end; t++)
+        {
+            int firstCol = t*RASTER_TILE_WIDTH;
+            int lastCol = std::min(firstCol + RASTER_TILE_WIDTH, w) - 1;
+            rasterizeTile(firstCol, lastCol);
+        }
+    });
+
+    batches.clear();
+}
+
+void LineRasterizer::rasterizeTile(int firstCol, int lastCol)
+{
+    for(size_t b=0; b<batches.size(); b++)
+    {
+        const Batch &batch = batches[b];
+        if(batch.lastCol < firstCol || batch.firstCol > lastCol)
+            continue;
+
+        // Heights are dequantised per tile rather than stored as floats
+        float xa = batch.xa*(w-1);
+        float xb = batch.xb*(w-1);
+        float yScale = (float)(h-1)/LINE_Y_LEVELS;
+        for(size_t i=0; i<batch.numLines; i++)
+        {
+            rasterizeLine(firstCol, lastCol,
+                          xa, (h-1) - batch.ya[i]*yScale,
+                          xb, (h-1) - batch.yb[i]*yScale,
+                          batch.palette + batch.labels[i]*4);
+        }
+    }
+}
+
+// Covers, in every column the line crosses, the rows between its entry
+// and exit heights, which keeps steep lines connected
+void LineRasterizer::rasterizeLine(int firstCol, int lastCol,
+                                   float xa, float ya, float xb, float yb,
+                                   const float *rgba)
+{
+    if(xb < xa)
+    {
+        std::swap(xa, xb);
+        std::swap(ya, yb);
+    }
+
+    int c0 = std::max(firstCol, (int)floorf(xa + 0.5f));
+    int c1 = std::min(lastCol, (int)floorf(xb + 0.5f));
+    if(c0 > c1)
+        return;
+
+    float alpha = rgba[3];
+    float r = rgba[0]*alpha;
+    float g = rgba[1]*alpha;
+    float b = rgba[2]*alpha;
+    float dydx = (xb > xa) ? (yb-ya)/(xb-xa) : 0.0f;
+
+    for(int c=c0; c<=c1; c++)
+    {
+        float y0 = ya;
+        float y1 = yb;
+        if(xb > xa)
+        {
+            y0 = ya + (std::max(xa, c-0.5f) - xa)*dydx;
+            y1 = ya + (std::min(xb, c+0.5f) - xa)*dydx;
+        }
+        if(y0 > y1)
+            std::swap(y0, y1);
+
+        int r0 = std::max(0, (int)floorf(y0 + 0.5f));
+        int r1 = std::min(h-1, (int)floorf(y1 + 0.5f));
+
+        float *p = &accum[((size_t)c*h + r0)*4];
+        for(int row=r0; row<=r1; row++, p+=4)
+        {
+            p[0] += r;
+            p[1] += g;
+            p[2] += b;
+            p[3] += alpha;
+        }
+    }
+}
+
+QImage LineRasterizer::toImage(float exposure) const
+{
+    QImage image(std::max(w,1), std::max(h,1), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if(w == 0 || h == 0)
+        return image;
+
+    uchar *bits = image.bits();
+    int bytesPerLine = image.bytesPerLine();
+
+    parallelChunks(h, [&](int, long long begin, long long end)
+    {
+        for(long long row=begin; row<end; row++)
+        {
+            QRgb *line = (QRgb*)(bits + row*bytesPerLine);
+            for(int col=0; col<w; col++)
+            {
+                const float *p = &accum[((size_t)col*h + row)*4];
+                if(p[3] <= 0)
+                    continue;
+
+                // Coverage approaches 1 as overlapping alpha accumulates
+                float coverage = 1.0f - expf(-p[3]*exposure);
+                float scale = 255.0f*coverage/p[3];
+                line[col] = qRgba((int)std::min(255.0f, p[0]*scale),
+                                  (int)std::min(255.0f, p[1]*scale),
+                                  (int)std::min(255.0f, p[2]*scale),
+                                  (int)(255.0f*coverage));
+            }
+        }
+    });
+
+    return image;
+}
@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef LINERASTERIZER_H
+#define LINERASTERIZER_H
+
+#include <QImage>
+
+#include <cstddef>
+#include <vector>
+
+// Columns of the framebuffer rasterized by one task
+#define RASTER_TILE_WIDTH 32
+// Quantised line heights run from 0 (bottom) to LINE_Y_LEVELS (top)
+#define LINE_Y_LEVELS 65535
+
+// CPU line renderer for views with too many lines to draw one by one.
+// Lines accumulate additively into a float framebuffer (colour weighted
+// by alpha, plus the summed alpha as density), split into column tiles
+// that worker threads fill independently. toImage() tone-maps the
+// density into coverage, so many faint lines saturate smoothly instead
+// of clipping.
+class LineRasterizer
+{
+public:
+    LineRasterizer();
+
+    void resize(int width, int height);
+    int width() const { return w; }
+    int height() const { return h; }
+
+    // Clears the framebuffer and forgets all batches
+    void clear();
+
+    // Queues numLines lines from x position xa to xb in [0,1], with the
+    // quantised heights of each line at either end in ya and yb and one
+    // label per line selecting its RGBA colour in palette. The arrays
+    // must stay valid until rasterize() returns.
+    void addBatch(float xa, float xb, const quint16 *ya, const quint16 *yb,
+                  const quint8 *labels, const float *palette, size_t numLines);
+
+    // Accumulates all queued batches into the framebuffer
+    void rasterize();
+
+    // Premultiplied image of the framebuffer; exposure scales density
+    // before it is mapped to coverage
+    QImage toImage(float exposure = 1.0f) const;
+
+private:
+    struct Batch
+    {
+        float xa;
+        float xb;
+        const quint16 *ya;
+        const quint16 *yb;
+        const quint8 *labels;
+        const float *palette;
+        size_t numLines;
+        int firstCol;
+        int lastCol;
+    };
+
+    void rasterizeTile(int firstCol, int lastCol);
+    void rasterizeLine(int firstCol, int lastCol,
+                       float xa, float ya, float xb, float yb,
+                       const float *rgba);
+
+private:
+    int w;
+    int h;
+
+    // Column-major, four floats per pixel (r*a, g*a, b*a, a), so every
+    // tile owns a contiguous block
+    std::vector<float> accum;
+    std::vector<Batch> batches;
+};
+
+#endif // LINERASTERIZER_H
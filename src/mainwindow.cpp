@@ -43,8 +43,8 @@
 #include <iostream>
 using namespace std;
 
-#include <QTimer>
 #include <QFileDialog>
+#include <QShortcut>
 
 // NEW FEATURES
 // Mem topo 1d memory range
@@ -92,6 +92,12 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->deselectAll, SIGNAL(clicked()), this, SLOT(deselectAll()));
     connect(ui->selectAllVisible, SIGNAL(clicked()), this, SLOT(selectAllVisible()));
 
+    // Selection history
+    QShortcut *undoShortcut = new QShortcut(QKeySequence::Undo, this);
+    QShortcut *redoShortcut = new QShortcut(QKeySequence::Redo, this);
+    connect(undoShortcut, SIGNAL(activated()), this, SLOT(undoSelection()));
+    connect(redoShortcut, SIGNAL(activated()), this, SLOT(redoSelection()));
+
     // Visibility buttons
     connect(ui->hideSelected, SIGNAL(clicked()), this, SLOT(hideSelected()));
     connect(ui->showSelectedOnly, SIGNAL(clicked()), this, SLOT(showSelectedOnly()));
@@ -154,21 +160,35 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->selOpacity, SIGNAL(valueChanged(int)), parallelCoordinatesViz, SLOT(setSelOpacity(int)));
     connect(ui->unselOpacity, SIGNAL(valueChanged(int)), parallelCoordinatesViz, SLOT(setUnselOpacity(int)));
     connect(ui->histogramBox, SIGNAL(clicked(bool)), parallelCoordinatesViz, SLOT(setShowHistograms(bool)));
+    connect(ui->binnedBox, SIGNAL(clicked(bool)), parallelCoordinatesViz, SLOT(setBinnedMode(bool)));
 
     vizWidgets.push_back(parallelCoordinatesViz);
 
+    /*
+     * Correlation Matrix Viz
+     */
+
+    correlationViz = new CorrelationMatrixViz(this);
+    ui->centerTabWidget->addTab(correlationViz, tr("Correlation"));
+
+    vizWidgets.push_back(correlationViz);
+
     /*
      * All VizWidgets
      */
 
+    // Widgets only get frames when they have work pending
+    frameScheduler = new FrameScheduler(this);
+
     // Set viz widgets to use new data
     for(int i=0; i<vizWidgets.size(); i++)
     {
         vizWidgets[i]->setDataSet(dataSet);
         vizWidgets[i]->setConsole(con);
+        vizWidgets[i]->setFrameScheduler(frameScheduler);
     }
 
-    dataSet->setConsole(con);
+    dataSet->setMessageHandler([this](QString msg) { con->log(msg); });
 
     connect(con, SIGNAL(selectionChangedSig()), this, SLOT(selectionChangedSlot()));
 
@@ -179,25 +199,12 @@ MainWindow::MainWindow(QWidget *parent) :
         connect(vizWidgets[i], SIGNAL(visibilityChangedSig()), this, SLOT(visibilityChangedSlot()));
         connect(this, SIGNAL(visibilityChangedSig()), vizWidgets[i], SLOT(visibilityChangedSlot()));
     }
-
-    frameTimer = new QTimer(this);
-    frameTimer->setInterval(1000/60); // 60fps
-    connect(frameTimer,SIGNAL(timeout()),this,SLOT(frameUpdateAll()));
-    frameTimer->start();
 }
 
 MainWindow::~MainWindow()
 {
 }
 
-void MainWindow::frameUpdateAll()
-{
-    for(int i=0; i<vizWidgets.size(); i++)
-    {
-        vizWidgets[i]->frameUpdate();
-    }
-}
-
 void MainWindow::selectionChangedSlot()
 {
     dataSet->selectionChanged();
@@ -224,6 +231,10 @@ int MainWindow::loadData()
     if(err != 0)
         return err;
 
+    // Background jobs read the samples that are about to be replaced
+    for(int i=0; i<vizWidgets.size(); i++)
+        vizWidgets[i]->cancelJobs();
+
     QString sourceDir(dataDir+QString("/src/"));
     codeViz->setSourceDir(sourceDir);
     QString topoDir(dataDir+QString("/hardware.xml"));
@@ -277,6 +288,18 @@ void MainWindow::selectAllVisible()
     selectionChangedSlot();
 }
 
+void MainWindow::undoSelection()
+{
+    if(dataSet->undoSelection())
+        selectionChangedSlot();
+}
+
+void MainWindow::redoSelection()
+{
+    if(dataSet->redoSelection())
+        selectionChangedSlot();
+}
+
 void MainWindow::selectAll()
 {
     dataSet->selectAll();
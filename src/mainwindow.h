@@ -41,15 +41,16 @@
 
 #include <QMainWindow>
 #include <QErrorMessage>
-#include <QTimer>
 
 #include <QVector>
 
 #include "vizwidget.h"
+#include "framescheduler.h"
 #include "codevizwidget.h"
 #include "varvizwidget.h"
 #include "pcvizwidget.h"
 #include "hwtopovizwidget.h"
+#include "correlationmatrixviz.h"
 
 #include "hwtopo.h"
 #include "codeeditor.h"
@@ -74,7 +75,6 @@ signals:
     void visibilityChangedSig();
 
 public slots:
-    void frameUpdateAll();
     void selectionChangedSlot();
     void visibilityChangedSlot();
     int loadData();
@@ -84,6 +84,8 @@ public slots:
     void hideSelected();
     void selectAllVisible();
     void selectAll();
+    void undoSelection();
+    void redoSelection();
     void deselectAll();
     void setSelectModeAND(bool on);
     void setSelectModeOR(bool on);
@@ -93,12 +95,13 @@ public slots:
 private:
     Ui::MainWindow *ui;
 
-    QTimer *frameTimer;
+    FrameScheduler *frameScheduler;
 
     CodeEditor *codeEditor;
     CodeViz *codeViz;
     HWTopoVizWidget *memViz;
     VarViz *varViz;
+    CorrelationMatrixViz *correlationViz;
 
     QVector<VizWidget*> vizWidgets;
     //VolumeVizWidget *volumeVizWidget;
@@ -0,0 +1,355 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+// memaxes-cli: runs console queries over a data directory without the GUI,
+// e.g. for batch analyses of many captures on compute nodes
+//
+//   memaxes-cli [--json] [-c <command>]... <data-dir>
+//   memaxes-cli [--json] --benchmark-ingest <MB>
+//
+// Commands are taken from -c options in order, or read from stdin one per
+// line when there are none. --benchmark-ingest writes a synthetic samples
+// file of the given size to a temporary directory and reports the CSV
+// parser's throughput on it.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <iostream>
+
+#include "dataobject.h"
+#include "analysis.h"
+
+static QString helpText(
+    "Commands :\n"
+    "    select DIMRANGE dim=vmin:vmax [dim=vmin:vmax ...]\n"
+    "    group <n>                      select into group n from now on\n"
+    "    group <dst> = <a> {|,&,-} <b>  combine selection groups\n"
+    "    undo | redo                    step through the selection history\n"
+    "    inspect\n"
+    "    resources\n"
+    "    vars [N]\n"
+    "    lines [N]\n"
+    "Summaries cover the selected samples, or all samples if none are selected.\n"
+);
+
+static void printError(QString msg)
+{
+    std::cerr << msg.toStdString() << std::endl;
+}
+
+// Runs one command line; tables are appended to results. In JSON mode
+// stdout carries only the result document, so help goes to stderr.
+// Returns false on errors.
+static bool runCommand(DataObject *dataSet, QString cmdLine, QList<ResultTable> &results, bool json)
+{
+    QStringList cmdArgs = cmdLine.simplified().split(" ");
+    CMD_TYPE cmdType = getCommandType(cmdArgs.first());
+
+    switch(cmdType)
+    {
+    case(CMD_HELP):
+        (json ? std::cerr : std::cout) << helpText.toStdString();
+        return true;
+    case(CMD_SELECT):
+    {
+        QString err = runSelectCommand(dataSet, cmdArgs);
+        if(!err.isEmpty())
+        {
+            printError(err);
+            return false;
+        }
+        dataSet->selectionChanged();
+        return true;
+    }
+    case(CMD_GROUP):
+    {
+        if(cmdArgs.size() > 1)
+        {
+            bool changed;
+            QString err = runGroupCommand(dataSet, cmdArgs, &changed);
+            if(!err.isEmpty())
+            {
+                printError(err);
+                return false;
+            }
+            if(changed)
+                dataSet->selectionChanged();
+        }
+        results << groupSummary(dataSet);
+        return true;
+    }
+    case(CMD_UNDO):
+    case(CMD_REDO):
+    {
+        bool stepped = (cmdType == CMD_UNDO) ? dataSet->undoSelection() : dataSet->redoSelection();
+        if(!stepped)
+        {
+            printError("Nothing to "+cmdLine.simplified());
+            return false;
+        }
+        dataSet->selectionChanged();
+        return true;
+    }
+    case(CMD_INSPECT):
+        results << selectionSummary(dataSet);
+        return true;
+    case(CMD_RESOURCES):
+        results << resourceSummary(dataSet);
+        return true;
+    case(CMD_VARIABLES):
+        results << topVariables(dataSet, topRowsArgument(cmdArgs));
+        return true;
+    case(CMD_LINES):
+        results << topLines(dataSet, topRowsArgument(cmdArgs));
+        return true;
+    default:
+        printError("Command unrecognized: "+cmdLine);
+        return false;
+    }
+}
+
+// Writes about megabytes MB of samples in the MemAxes CSV layout, with
+// names from small pools as in real captures. Returns the number of rows.
+static qint64 writeSyntheticSamples(QString fileName, qint64 megabytes)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return -1;
+
+    const char *sources[] = { "lulesh.cc", "lulesh-comm.cc", "lulesh-util.cc", "??" };
+    const char *instructions[] = { "mov", "movsd", "vmovupd", "add", "??" };
+    const char *variables[] = { "m_x", "m_y", "m_z", "m_xd", "m_fx", "m_nodelist", "??" };
+    const char *levels[] = { "L1", "LFB", "L2", "L3", "Local RAM", "Remote RAM 1 Hop" };
+
+    QByteArray buffer("source,line,instruction,bytes,ip,variable,buffer_size,dims,"
+                      "xidx,yidx,zidx,pid,tid,time,addr,cpu,latency,level\n");
+    qint64 targetBytes = megabytes*1024*1024;
+    qint64 written = 0;
+    qint64 rows = 0;
+    quint64 seed = 88172645463325252ULL;
+    char row[512];
+
+    while(written + buffer.size() < targetBytes)
+    {
+        // xorshift, so the file is the same on every run
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        int cpu = seed % 64;
+        int level = (seed >> 8) % 6;
+        int len = snprintf(row, sizeof(row),
+                           "%s,%d,%s,8,%llu,%s,%d,1,%d,0,0,24511,%d,%llu,%llu,%d,%d,%s\n",
+                           sources[(seed >> 12) % 4], (int)((seed >> 16) % 2000),
+                           instructions[(seed >> 20) % 5], 93992958121519ULL + (seed >> 24) % 65536,
+                           variables[(seed >> 28) % 7], (int)((seed >> 32) % 1000000),
+                           (int)((seed >> 36) % 1024), 24511 + cpu,
+                           6045777543909725ULL + rows*1000, 140728173432712ULL + (seed >> 40) % (1 << 20),
+                           cpu, 4 + level*20 + (int)((seed >> 44) % 300), levels[level]);
+        buffer.append(row, len);
+        rows++;
+
+        if(buffer.size() > (1 << 22))
+        {
+            written += file.write(buffer);
+            buffer.clear();
+        }
+    }
+    written += file.write(buffer);
+
+    return file.error() == QFile::NoError ? rows : -1;
+}
+
+static int runIngestBenchmark(qint64 megabytes, bool json)
+{
+    QTemporaryDir dir;
+    QString fileName = dir.path()+"/samples.csv";
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 rows = writeSyntheticSamples(fileName, megabytes);
+    if(!dir.isValid() || rows < 0)
+    {
+        printError("Unable to write "+fileName);
+        return 1;
+    }
+    printError(QString("Wrote %1 synthetic rows in %2 s").arg(rows).arg(timer.elapsed()/1000.0,0,'f',2));
+
+    DataObject dataSet;
+    dataSet.setMessageHandler([](QString msg) { printError(msg); });
+
+    qreal fileMB = (qreal)QFile(fileName).size() / (1024.0*1024.0);
+    timer.restart();
+    if(dataSet.parseCSVFile(fileName) != 0)
+    {
+        printError("Error parsing "+fileName);
+        return 1;
+    }
+    qreal seconds = std::max(timer.elapsed(),1LL) / 1000.0;
+
+    ResultTable table;
+    table.title = "CSV ingest";
+    table.columns << "rows" << "MB" << "seconds" << "rows/s" << "MB/s";
+    table.rows << (QVariantList() << (qlonglong)dataSet.samples.size() << fileMB << seconds
+                                  << (qlonglong)(dataSet.samples.size()/seconds) << fileMB/seconds);
+
+    if(json)
+        std::cout << QJsonDocument(table.toJson()).toJson().toStdString();
+    else
+        std::cout << table.toText().toStdString() << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("memaxes-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs MemAxes console queries on a data directory.\n\n"+helpText);
+    parser.addHelpOption();
+    parser.addPositionalArgument("data-dir", "Directory containing hardware.xml and data/samples.csv");
+
+    QCommandLineOption commandOption(QStringList() << "c" << "command",
+                                     "Run <command>; may be repeated. Without any, commands are read from stdin.",
+                                     "command");
+    QCommandLineOption jsonOption("json", "Print the results as one JSON document.");
+    QCommandLineOption benchmarkOption("benchmark-ingest",
+                                       "Report the CSV parser's throughput on a synthetic samples file of <MB> megabytes.",
+                                       "MB");
+    parser.addOption(commandOption);
+    parser.addOption(jsonOption);
+    parser.addOption(benchmarkOption);
+
+    parser.process(app);
+
+    if(parser.isSet(benchmarkOption))
+    {
+        bool ok;
+        qint64 megabytes = parser.value(benchmarkOption).toLongLong(&ok);
+        if(!ok || megabytes <= 0)
+        {
+            printError("Expected a size in MB for --benchmark-ingest");
+            return 1;
+        }
+        return runIngestBenchmark(megabytes, parser.isSet(jsonOption));
+    }
+
+    QStringList positional = parser.positionalArguments();
+    if(positional.size() != 1)
+    {
+        printError("Expected exactly one data directory");
+        parser.showHelp(1);
+    }
+
+    QString dataDir = positional.first();
+    bool json = parser.isSet(jsonOption);
+
+    // Status messages go to stderr so stdout only holds results
+    DataObject dataSet;
+    dataSet.setMessageHandler([](QString msg) { printError(msg); });
+
+    QString topoFile(dataDir+"/hardware.xml");
+    if(dataSet.loadHardwareTopology(topoFile) != 0)
+    {
+        printError("Error loading hardware: "+topoFile);
+        return 1;
+    }
+
+    QString samplesFile(dataDir+"/data/samples.csv");
+    if(dataSet.loadData(samplesFile) != 0)
+    {
+        printError("Error loading dataset: "+samplesFile);
+        return 1;
+    }
+
+    // Binds the samples to the topology and computes the statistics of
+    // the (empty) selection
+    dataSet.selectionChanged();
+
+    QStringList commands = parser.values(commandOption);
+    if(commands.isEmpty())
+    {
+        QTextStream in(stdin);
+        while(!in.atEnd())
+        {
+            QString line = in.readLine().simplified();
+            if(!line.isEmpty() && !line.startsWith("#"))
+                commands << line;
+        }
+    }
+
+    int err = 0;
+    QList<ResultTable> results;
+    for(int i=0; i<commands.size(); i++)
+    {
+        QList<ResultTable> cmdResults;
+        if(!runCommand(&dataSet, commands[i], cmdResults, json))
+            err = 1;
+
+        // Text results are printed as they come, JSON ones all at the end
+        if(!json)
+        {
+            for(int t=0; t<cmdResults.size(); t++)
+                std::cout << cmdResults[t].toText().toStdString() << std::endl;
+        }
+        results << cmdResults;
+    }
+
+    if(json)
+    {
+        QJsonArray jsonResults;
+        for(int t=0; t<results.size(); t++)
+            jsonResults.append(results[t].toJson());
+
+        QJsonObject doc;
+        doc.insert("dataDir", dataDir);
+        doc.insert("results", jsonResults);
+        std::cout << QJsonDocument(doc).toJson().toStdString();
+    }
+
+    return err;
+}
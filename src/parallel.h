@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Number of worker threads used by the data processing routines
+inline int numWorkerThreads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+// Split [0,n) into numChunks contiguous ranges and call
+// fn(chunk, begin, end) for each of them on its own thread. The
+// calling thread processes the first chunk itself.
+template <typename Fn>
+void parallelChunks(long long n, int numChunks, Fn fn)
+{
+    numChunks = (int)std::max(1LL, std::min((long long)numChunks, n));
+
+    long long chunkSize = n / numChunks;
+    long long remainder = n % numChunks;
+
+    std::vector<long long> bounds(numChunks+1, 0);
+    for(int c=0; c<numChunks; c++)
+        bounds[c+1] = bounds[c] + chunkSize + (c < remainder ? 1 : 0);
+
+    std::vector<std::thread> workers;
+    for(int c=1; c<numChunks; c++)
+        workers.push_back(std::thread(fn, c, bounds[c], bounds[c+1]));
+
+    fn(0, bounds[0], bounds[1]);
+
+    for(unsigned int t=0; t<workers.size(); t++)
+        workers[t].join();
+}
+
+// Same as above with one chunk per worker thread
+template <typename Fn>
+void parallelChunks(long long n, Fn fn)
+{
+    parallelChunks(n, numWorkerThreads(), fn);
+}
+
+#endif // PARALLEL_H
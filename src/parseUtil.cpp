@@ -38,15 +38,155 @@
 
 #include "parseUtil.h"
 
-size_t createUniqueID(QVector<QString> &existing, QString name)
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const char *findNewline(const char *begin, const char *end)
+{
+    // memchr is vectorized by the C library
+    const void *nl = memchr(begin, '\n', end-begin);
+    return nl ? (const char*)nl : end;
+}
+
+int tokenizeCSVLine(const char *begin, const char *end, ByteRange *fields, int maxFields)
+{
+    int numFields = 0;
+    const char *fieldBegin = begin;
+    const char *p = begin;
+
+#if defined(__SSE2__)
+    // Compare 16 bytes at a time and walk the bitmask of commas
+    const __m128i commas = _mm_set1_epi8(',');
+    for(; end-p >= 16; p += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)p);
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, commas));
+        while(mask)
+        {
+            const char *comma = p + __builtin_ctz(mask);
+            if(numFields < maxFields)
+            {
+                fields[numFields].begin = fieldBegin;
+                fields[numFields].end = comma;
+            }
+            numFields++;
+            fieldBegin = comma+1;
+            mask &= mask-1;
+        }
+    }
+#endif
+
+    for(; p<end; p++)
+    {
+        if(*p != ',')
+            continue;
+        if(numFields < maxFields)
+        {
+            fields[numFields].begin = fieldBegin;
+            fields[numFields].end = p;
+        }
+        numFields++;
+        fieldBegin = p+1;
+    }
+
+    if(numFields < maxFields)
+    {
+        fields[numFields].begin = fieldBegin;
+        fields[numFields].end = end;
+    }
+    return numFields+1;
+}
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Same results as QString::toLongLong: surrounding whitespace is
+// ignored and malformed or out of range values yield 0
+long long parseLongLong(const char *begin, const char *end)
+{
+    while(begin < end && isBlank(*begin))
+        begin++;
+    while(end > begin && isBlank(*(end-1)))
+        end--;
+
+    bool negative = false;
+    if(begin < end && (*begin == '-' || *begin == '+'))
+    {
+        negative = (*begin == '-');
+        begin++;
+    }
+    if(begin == end)
+        return 0;
+
+    unsigned long long limit = negative ? (unsigned long long)LLONG_MAX + 1 : LLONG_MAX;
+    unsigned long long val = 0;
+    for(; begin<end; begin++)
+    {
+        unsigned int digit = (unsigned char)*begin - '0';
+        if(digit > 9 || val > (limit - digit) / 10)
+            return 0;
+        val = val*10 + digit;
+    }
+
+    return negative ? (long long)(0ULL - val) : (long long)val;
+}
+
+int parseInt(const char *begin, const char *end)
+{
+    long long val = parseLongLong(begin, end);
+    if(val < INT_MIN || val > INT_MAX)
+        return 0;
+    return (int)val;
+}
+
+static quint64 fnv1a(const char *data, qint64 len, quint64 hash)
 {
-    for(int i=0; i<existing.size(); i++)
+    for(qint64 i=0; i<len; i++)
     {
-        if(existing[i] == name)
-            return i;
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
     }
-    existing.push_back(name);
-    return existing.size()-1;
+    return hash;
+}
+
+quint64 fileFingerprint(QString fileName)
+{
+    const int numBlocks = 16;
+    const qint64 blockSize = 64*1024;
+
+    QFileInfo info(fileName);
+    qint64 size = info.size();
+    qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+
+    quint64 hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a((const char*)&size, sizeof(size), hash);
+    hash = fnv1a((const char*)&mtime, sizeof(mtime), hash);
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return hash;
+
+    // Hash evenly spaced blocks from the first to the last byte
+    for(int b=0; b<numBlocks; b++)
+    {
+        qint64 offset = std::max(0LL, (size-blockSize) * b / (numBlocks-1));
+        file.seek(offset);
+        QByteArray block = file.read(blockSize);
+        hash = fnv1a(block.constData(), block.size(), hash);
+    }
+
+    return hash;
 }
 
 int dseDepth(int enc)
@@ -39,7 +39,24 @@
 #include <QVector>
 #include <QString>
 
-size_t createUniqueID(QVector<QString> &existing, QString name);
+// Half-open byte range [begin,end) inside a text buffer
+struct ByteRange
+{
+    const char *begin;
+    const char *end;
+
+    int size() const { return (int)(end-begin); }
+};
+
+// Byte-level CSV parsing (no QString allocations)
+const char *findNewline(const char *begin, const char *end);
+int tokenizeCSVLine(const char *begin, const char *end, ByteRange *fields, int maxFields);
+long long parseLongLong(const char *begin, const char *end);
+int parseInt(const char *begin, const char *end);
+
+// Cheap content fingerprint (size, mtime and sampled blocks) of a file
+quint64 fileFingerprint(QString fileName);
+
 int dseDepth(int enc);
 int dseDirty(int enc);
 std::string encToString(int enc);
@@ -45,6 +45,7 @@
 #include <algorithm>
 
 #include "util.h"
+#include "parallel.h"
 
 PCVizWidget::PCVizWidget(QWidget *parent)
     : VizWidget(parent)
@@ -62,18 +63,20 @@ PCVizWidget::PCVizWidget(QWidget *parent)
     colorMap.push_back(QColor(255,255,153));
     colorMap.push_back(QColor(177,89,40 ));
 
-    needsCalcHistBins = true;
-    needsCalcMinMaxes = true;
     needsProcessData = true;
     needsProcessSelection = true;
-    needsRecalcLines = true;
     needsRepaint = true;
 
+    statsSubmitted = 0;
+    linesSubmitted = 0;
+    lineBuffers.reset(new LineBuffers());
+
     selOpacity = 0.4;
     unselOpacity = 0.1;
 
     numHistBins = 100;
     showHistograms = true;
+    binnedMode = false;
 
     cursorPos.setX(-1);
     selectionAxis = -1;
@@ -90,10 +93,34 @@ PCVizWidget::PCVizWidget(QWidget *parent)
 }
 
 #define LINES_PER_DATAPT    (numDimensions-1)
-#define POINTS_PER_LINE     2
-#define FLOATS_PER_POINT    2
 #define FLOATS_PER_COLOR    4
 
+// Opacity of the densest band in binned mode
+#define BAND_MAX_OPACITY    0.8
+
+#define PLOT_MARGIN_X       40
+#define PLOT_MARGIN_Y       30
+
+// Pipeline keys of the background jobs
+#define PC_JOB_STATS        0
+#define PC_JOB_LINES        1
+
+void PCVizWidget::StatsChanges::merge(const StatsChanges &other)
+{
+    minMaxes |= other.minMaxes;
+    histBins |= other.histBins;
+    pairs |= other.pairs;
+    resetPairs |= other.resetPairs;
+}
+
+void PCVizWidget::LineChanges::merge(const LineChanges &other)
+{
+    rebuild |= other.rebuild;
+    movedAxes |= other.movedAxes;
+    colors |= other.colors;
+    raster |= other.raster;
+}
+
 void PCVizWidget::processData()
 {
     processed = false;
@@ -119,10 +146,6 @@ void PCVizWidget::processData()
     axesPositions.resize(numDimensions);
     axesOrder.resize(numDimensions);
 
-    histVals.resize(numDimensions);
-    histMaxVals.resize(numDimensions);
-    histMaxVals.fill(0);
-
     // Initial axis positions and order
     for(int i=0; i<numDimensions; i++)
     {
@@ -130,22 +153,27 @@ void PCVizWidget::processData()
             axesOrder[i] = i;
 
         axesPositions[axesOrder[i]] = i*(1.0/(numDimensions-1));
-
-        histVals[i].resize(numHistBins);
-        histVals[i].fill(0);
     }
 
     processed = true;
 
-    needsCalcMinMaxes = true;
-    needsCalcHistBins = true;
-    needsRecalcLines = true;
+    pairHistograms.clear();
+    histograms = SampleHistograms();
+    lineBuffers.reset(new LineBuffers());
+    lineImage = QImage();
+
+    statsChanges.minMaxes = true;
+    statsChanges.histBins = true;
+    statsChanges.pairs = true;
+    statsChanges.resetPairs = true;
+    lineChanges.rebuild = true;
 }
 
 void PCVizWidget::leaveEvent(QEvent *e)
 {
     VizWidget::leaveEvent(e);
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::mousePressEvent(QMouseEvent *mouseEvent)
@@ -182,6 +210,7 @@ void PCVizWidget::mouseReleaseEvent(QMouseEvent *event)
     }
 
     needsProcessSelection = true;
+    requestFrame();
 
     movingAxis = -1;
     selectionAxis = -1;
@@ -202,6 +231,10 @@ bool PCVizWidget::eventFilter(QObject *obj, QEvent *event)
     QPoint mousePos = mouseEvent->pos();
     QPoint mouseDelta = mousePos - prevMousePos;
 
+    // The line image is rasterized at the plot size
+    if (event->type() == QEvent::Resize)
+        needsRepaint = true;
+
     if (event->type() == QEvent::MouseMove)
     {
         // Dragging to create a selection
@@ -250,7 +283,10 @@ bool PCVizWidget::eventFilter(QObject *obj, QEvent *event)
                 }
             }
 
-            needsRecalcLines = true;
+            // Only pairs that became adjacent need a new histogram, and
+            // only the segments next to the moved axis new vertices
+            statsChanges.pairs = true;
+            recalcLines(movingAxis);
             needsRepaint = true;
         }
     }
@@ -258,6 +294,9 @@ bool PCVizWidget::eventFilter(QObject *obj, QEvent *event)
     prevMousePos = mousePos;
     prevCursorPos = cursorPos;
 
+    if(needsRepaint)
+        requestFrame();
+
     return false;
 }
 
@@ -308,11 +347,11 @@ void PCVizWidget::processSelection()
     {
         if(animationAxis != -1)
         {
+            // One selection change per frame, so the statistics only
+            // update for the slice the window moved over
             selection_mode s = dataSet->selectionMode();
             dataSet->setSelectionMode(MODE_NEW,true);
-            dataSet->selectSet(animSet);
-            dataSet->setSelectionMode(MODE_FILTER,true);
-            dataSet->selectByMultiDimRange(selDims,dataSelMins,dataSelMaxes);
+            dataSet->selectSet(animSet & dataSet->multiDimRangeSet(selDims,dataSelMins,dataSelMaxes));
             dataSet->setSelectionMode(s,true);
         }
         else
@@ -327,219 +366,396 @@ void PCVizWidget::processSelection()
         selMaxes.fill(-1);
     }
 
-    needsRecalcLines = true;
+    lineChanges.colors = true;
 
     emit selectionChangedSig();
 }
 
-void PCVizWidget::calcMinMaxes()
+void PCVizWidget::calcMinMaxes(const Snapshot &snap, QVector<qreal> &mins, QVector<qreal> &maxes)
 {
-    if(!processed)
-        return;
+    mins.fill(std::numeric_limits<double>::max(), snap.numDimensions);
+    maxes.fill(std::numeric_limits<double>::min(), snap.numDimensions);
 
-    dimMins.fill(std::numeric_limits<double>::max());
-    dimMaxes.fill(std::numeric_limits<double>::min());
+    qreal *minData = mins.data();
+    qreal *maxData = maxes.data();
+    ElemIndex numSamples = snap.samples->size();
 
-    for( Sample s : dataSet->samples)
+    parallelChunks(snap.numDimensions, [&](int, long long begin, long long end)
     {
-        if(!dataSet->visible(s.sampleId))
-            continue;
-        for(int i=0; i<numDimensions; i++)
+        for(long long i=begin; i<end; i++)
         {
-            long long val = dataSet->GetSampleAttribByIndex(&s, i);
-            dimMins[i] = std::min(dimMins[i],(qreal)val);
-            dimMaxes[i] = std::max(dimMaxes[i],(qreal)val);
+            const long long *vals = snap.samples->column(i);
+            for(ElemIndex elem=0; elem<numSamples; elem++)
+            {
+                if(!snap.visible(elem))
+                    continue;
+                minData[i] = std::min(minData[i],(qreal)vals[elem]);
+                maxData[i] = std::max(maxData[i],(qreal)vals[elem]);
+            }
         }
-    }
-    // int elem;
-    // QVector<qreal>::Iterator p;
-    // for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=numDimensions)
-    // {
-    //     if(!dataSet->visible(elem))
-    //         continue;
-    //
-    //     for(int i=0; i<numDimensions; i++)
-    //     {
-    //         dimMins[i] = std::min(dimMins[i],*(p+i));
-    //         dimMaxes[i] = std::max(dimMaxes[i],*(p+i));
-    //     }
-    // }
-}
-
-void PCVizWidget::calcHistBins()
+    });
+}
+
+void PCVizWidget::calcHistBins(const Snapshot &snap, SampleHistograms &hists)
 {
-    if(!processed)
-        return;
+    calcHistograms(*snap.samples, snap.dimMins.constData(), snap.dimMaxes.constData(), snap.numHistBins,
+                   [&](ElemIndex elem) { return snap.visible(elem); },
+                   [&](ElemIndex elem) { return snap.selected(elem); },
+                   hists);
+}
 
-    histMaxVals.fill(0);
+// Fills in the joint histograms of adjacent axis pairs that are not
+// cached yet, so an axis reorder only scans the samples for new pairs
+void PCVizWidget::calcPairHistograms(const Snapshot &snap, PairHistograms &pairs, const JobToken &token)
+{
+    int numDimensions = snap.numDimensions;
+    int numHistBins = snap.numHistBins;
+    const QVector<int> &axesOrder = snap.axesOrder;
 
-    for( Sample s : dataSet->samples)
+    QVector<int> missing;
+    for(int i=0; i<numDimensions-1; i++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(s.sampleId))
-            continue;
+        int low = std::min(axesOrder[i],axesOrder[i+1]);
+        int high = std::max(axesOrder[i],axesOrder[i+1]);
+        int key = low*numDimensions+high;
+        if(!pairs.contains(key) && !missing.contains(key))
+            missing.push_back(key);
+    }
+
+    bool selectionDefined = snap.selectionDefined;
+    ElemIndex numSamples = snap.samples->size();
+    int numBins = numHistBins*numHistBins;
+    int numGroups = MAX_SELECTION_GROUPS+1;
+    int numWorkers = numWorkerThreads();
 
-        for(int i=0; i<numDimensions; i++)
+    for(int k=0; k<missing.size() && !token.cancelled(); k++)
+    {
+        int low = missing[k] / numDimensions;
+        int high = missing[k] % numDimensions;
+        const long long *lowVals = snap.samples->column(low);
+        const long long *highVals = snap.samples->column(high);
+        AxisBinning lowBinning(snap.dimMins[low], snap.dimMaxes[low], numHistBins);
+        AxisBinning highBinning(snap.dimMins[high], snap.dimMaxes[high], numHistBins);
+
+        // Per-worker counts of every group
+        std::vector<QVector<quint32> > workerCounts(numWorkers);
+        parallelChunks(numSamples, numWorkers, [&](int w, long long begin, long long end)
         {
-            long long val = dataSet->GetSampleAttribByIndex(&s, i);
+            QVector<quint32> &counts = workerCounts[w];
+            counts.fill(0, numGroups*numBins);
+
+            for(long long elem=begin; elem<end; elem++)
+            {
+                if(!snap.visible(elem))
+                    continue;
 
-            int histBin = floor(scale(val,dimMins[i],dimMaxes[i],0,numHistBins));
+                int lowBin = lowBinning.bin(lowVals[elem]);
+                int highBin = highBinning.bin(highVals[elem]);
+                int group = selectionDefined ? snap.selection.at(elem) : 0;
 
-            if(histBin >= numHistBins)
-                histBin = numHistBins-1;
-            if(histBin < 0)
-                histBin = 0;
+                counts[group*numBins + lowBin*numHistBins+highBin]++;
+            }
+        });
 
-            histVals[i][histBin] += 1;
-            histMaxVals[i] = std::max(histMaxVals[i],histVals[i][histBin]);
+        PairHistogram hist;
+        hist.counts.fill(0, numGroups*numBins);
+        hist.maxCount = 0;
+        for(unsigned int w=0; w<workerCounts.size(); w++)
+        {
+            if(workerCounts[w].isEmpty())
+                continue;
+            for(int b=0; b<numGroups*numBins; b++)
+                hist.counts[b] += workerCounts[w][b];
+        }
+        for(int b=0; b<numBins; b++)
+        {
+            quint32 total = 0;
+            for(int g=0; g<numGroups; g++)
+                total += hist.counts[g*numBins + b];
+            hist.maxCount = std::max(hist.maxCount, total);
         }
-    }
 
-    // int elem;
-    // QVector<qreal>::Iterator p;
-    // for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=numDimensions)
-    // {
-    //     if(dataSet->selectionDefined() && !dataSet->selected(elem))
-    //         continue;
-    //
-    //     for(int i=0; i<numDimensions; i++)
-    //     {
-    //         int histBin = floor(scale(*(p+i),dimMins[i],dimMaxes[i],0,numHistBins));
-    //
-    //         if(histBin >= numHistBins)
-    //             histBin = numHistBins-1;
-    //         if(histBin < 0)
-    //             histBin = 0;
-    //
-    //         histVals[i][histBin] += 1;
-    //         histMaxVals[i] = std::max(histMaxVals[i],histVals[i][histBin]);
-    //     }
-    // }
-
-    // Scale hist values to [0,1]
-    for(int i=0; i<numDimensions; i++)
-        for(int j=0; j<numHistBins; j++)
-            histVals[i][j] = scale(histVals[i][j],0,histMaxVals[i],0,1);
+        pairs.insert(missing[k], hist);
+    }
 }
 
+// Requests new line buffers for all visible samples, or with dirtyAxis
+// set only a new raster for the axis move or reorder
 void PCVizWidget::recalcLines(int dirtyAxis)
 {
-    QVector4D col;
-    QVector2D a, b;
-    int i, axis, nextAxis;//, elem;
-    // QVector<double>::Iterator p;
-
-    if(!processed)
-        return;
+    if(dirtyAxis == -1)
+        lineChanges.rebuild = true;
+    else
+        lineChanges.movedAxes |= 1u << dirtyAxis;
+}
 
-    verts.clear();
-    colors.clear();
+// Brings the line buffers up to date in place and renders them. The
+// buffers hold one quantised height per axis and line, and the
+// rasterizer joins adjacent axes itself, so moving or reordering axes
+// rewrites nothing; selection and opacity changes only rewrite colours.
+QImage PCVizWidget::updateLines(const Snapshot &snap, const LineChanges &changes,
+                                LineBuffers &buffers, const JobToken &token)
+{
+    bool rebuild = changes.rebuild || !buffers.valid ||
+                   buffers.axisYs.size() != (size_t)snap.numDimensions*buffers.numLines;
 
-    QVector4D redVec = QVector4D(255,0,0,255);
-    QColor dataSetColor = colorMap.at(0);
-    qreal Cr,Cg,Cb;
-    dataSetColor.getRgbF(&Cr,&Cg,&Cb);
-    QVector4D dataColor = QVector4D(Cr,Cg,Cb,1);
+    // Stays invalid if the job is cancelled halfway, so the next one
+    // starts over
+    buffers.valid = false;
 
-    for( Sample s : dataSet->samples)
+    if(rebuild)
     {
-        if(!dataSet->visible(s.sampleId))
+        buffers.lineElems.clear();
+        for(ElemIndex elem=0; elem<snap.samples->size(); elem++)
         {
-            continue;
+            if(snap.visible(elem))
+                buffers.lineElems.push_back(elem);
         }
-        else if(dataSet->selected(s.sampleId))
+
+        buffers.numLines = buffers.lineElems.size();
+        buffers.axisYs.resize((size_t)snap.numDimensions*buffers.numLines);
+        buffers.lineGroups.resize(buffers.numLines);
+
+        for(int axis=0; axis<snap.numDimensions; axis++)
         {
-            col = redVec;
-            col.setW(selOpacity);
+            if(token.cancelled())
+                return QImage();
+            recalcAxisHeights(snap, buffers, axis);
         }
-        else
+    }
+
+    if(rebuild || changes.colors)
+        recalcLineColors(snap, buffers);
+
+    if(token.cancelled())
+        return QImage();
+    buffers.valid = true;
+
+    LineRasterizer &rasterizer = buffers.rasterizer;
+    if(snap.plotSize.width() != rasterizer.width() || snap.plotSize.height() != rasterizer.height())
+        rasterizer.resize(snap.plotSize.width(), snap.plotSize.height());
+    rasterizer.clear();
+
+    for(int i=0; i<snap.numDimensions-1; i++)
+    {
+        int axis = snap.axesOrder[i];
+        int nextAxis = snap.axesOrder[i+1];
+        rasterizer.addBatch(snap.axesPositions[axis],
+                            snap.axesPositions[nextAxis],
+                            buffers.axisYs.data() + (size_t)axis*buffers.numLines,
+                            buffers.axisYs.data() + (size_t)nextAxis*buffers.numLines,
+                            buffers.lineGroups.data(),
+                            buffers.palette.data(),
+                            buffers.numLines);
+    }
+
+    rasterizer.rasterize();
+    return rasterizer.toImage();
+}
+
+// Heights of every line on one axis, scaled to the axis range and
+// quantised to LINE_Y_LEVELS
+void PCVizWidget::recalcAxisHeights(const Snapshot &snap, LineBuffers &buffers, int axis)
+{
+    const long long *vals = snap.samples->column(axis);
+    qreal vMin = snap.dimMins[axis];
+    qreal vMax = snap.dimMaxes[axis];
+
+    const QVector<ElemIndex> &lineElems = buffers.lineElems;
+    quint16 *ys = buffers.axisYs.data() + (size_t)axis*buffers.numLines;
+    parallelChunks(buffers.numLines, [&](int, long long begin, long long end)
+    {
+        for(long long l=begin; l<end; l++)
         {
-            col = dataColor;
-            col.setW(unselOpacity);
+            qreal y = qBound(0.0, scale(vals[lineElems.at(l)],vMin,vMax,0,1), 1.0);
+            ys[l] = (quint16)(y*LINE_Y_LEVELS + 0.5);
         }
+    });
+}
 
-        for(i=0; i<numDimensions-1; i++)
-        {
-            if(dirtyAxis != -1  && i != dirtyAxis && i != dirtyAxis-1)
-                continue;
+// A line has the same colour on every segment, so only its group label
+// is stored; the palette maps labels to colours and opacities
+void PCVizWidget::recalcLineColors(const Snapshot &snap, LineBuffers &buffers)
+{
+    buffers.palette.resize(snap.groupColors.size()*FLOATS_PER_COLOR);
+    for(int g=0; g<snap.groupColors.size(); g++)
+    {
+        const QVector4D &col = snap.groupColors.at(g);
+        GLfloat *c = buffers.palette.data() + g*FLOATS_PER_COLOR;
+        c[0] = col.x();
+        c[1] = col.y();
+        c[2] = col.z();
+        c[3] = col.w();
+    }
 
-            axis = axesOrder[i];
-            nextAxis = axesOrder[i+1];
+    const QVector<ElemIndex> &lineElems = buffers.lineElems;
+    quint8 *groups = buffers.lineGroups.data();
+    parallelChunks(buffers.numLines, [&](int, long long begin, long long end)
+    {
+        for(long long l=begin; l<end; l++)
+            groups[l] = snap.selection.at(lineElems.at(l));
+    });
+}
 
-            float orig_aVal = dataSet->GetSampleAttribByIndex(&s, axis);
-            float aVal = scale(orig_aVal,dimMins[axis],dimMaxes[axis],0,1);
-            a = QVector2D(axesPositions[axis],aVal);
+PCVizWidget::Snapshot PCVizWidget::snapshot()
+{
+    Snapshot snap;
+    snap.samples = &dataSet->samples;
+    snap.visibility = dataSet->visibilityMask();
+    snap.selection = dataSet->selectionGroups();
+    snap.selectionDefined = dataSet->selectionDefined();
+
+    snap.numDimensions = numDimensions;
+    snap.numHistBins = numHistBins;
+    snap.dimMins = dimMins;
+    snap.dimMaxes = dimMaxes;
+    snap.axesOrder = axesOrder;
+    snap.axesPositions = axesPositions;
 
-            float orig_bVal = dataSet->GetSampleAttribByIndex(&s, nextAxis);
-            float bVal = scale(orig_bVal,dimMins[nextAxis],dimMaxes[nextAxis],0,1);
-            b = QVector2D(axesPositions[nextAxis],bVal);
+    qreal Cr,Cg,Cb;
+    for(int g=0; g<=MAX_SELECTION_GROUPS; g++)
+    {
+        groupColor(g).getRgbF(&Cr,&Cg,&Cb);
+        snap.groupColors.push_back(QVector4D(Cr,Cg,Cb,g ? selOpacity : unselOpacity));
+    }
+    snap.plotSize = plotSize();
 
-            verts.push_back(a.x());
-            verts.push_back(a.y());
+    return snap;
+}
 
-            verts.push_back(b.x());
-            verts.push_back(b.y());
+// Colour of a selection group's lines and bands, 0 is unselected
+QColor PCVizWidget::groupColor(int group) const
+{
+    return group ? selectionGroupColor(group) : colorMap.at(0);
+}
 
-            colors.push_back(col.x());
-            colors.push_back(col.y());
-            colors.push_back(col.z());
-            colors.push_back(col.w());
+QSize PCVizWidget::plotSize() const
+{
+    return QSize(width()-2*PLOT_MARGIN_X, height()-2*PLOT_MARGIN_Y);
+}
 
-            colors.push_back(col.x());
-            colors.push_back(col.y());
-            colors.push_back(col.z());
-            colors.push_back(col.w());
-        }
+void PCVizWidget::submitStatsJob()
+{
+    if(!processed)
+        return;
+
+    // Pair histograms are only kept while binned mode shows them
+    if(!binnedMode && statsChanges.resetPairs)
+    {
+        pairHistograms.clear();
+        statsChanges.resetPairs = false;
+    }
+    if(!binnedMode)
+        statsChanges.pairs = false;
+
+    if(!statsChanges.any())
+        return;
+
+    StatsChanges changes = statsChanges;
+    changes.merge(statsInFlight);
+    if(changes.minMaxes)
+    {
+        changes.histBins = true;
+        changes.resetPairs = true;
     }
-    //
-    // for(p=dataSet->begin, elem=0; p!=dataSet->end; p+=numDimensions, elem++)
-    // {
-    //     if(!dataSet->visible(elem))
-    //     {
-    //         continue;
-    //     }
-    //     else if(dataSet->selected(elem))
-    //     {
-    //         col = redVec;
-    //         col.setW(selOpacity);
-    //     }
-    //     else
-    //     {
-    //         col = dataColor;
-    //         col.setW(unselOpacity);
-    //     }
-    //
-    //
-    //     for(i=0; i<numDimensions-1; i++)
-    //     {
-    //         if(dirtyAxis != -1  && i != dirtyAxis && i != dirtyAxis-1)
-    //             continue;
-    //
-    //         axis = axesOrder[i];
-    //         nextAxis = axesOrder[i+1];
-    //
-    //         float aVal = scale(*(p+axis),dimMins[axis],dimMaxes[axis],0,1);
-    //         a = QVector2D(axesPositions[axis],aVal);
-    //
-    //         float bVal = scale(*(p+nextAxis),dimMins[nextAxis],dimMaxes[nextAxis],0,1);
-    //         b = QVector2D(axesPositions[nextAxis],bVal);
-    //
-    //         verts.push_back(a.x());
-    //         verts.push_back(a.y());
-    //
-    //         verts.push_back(b.x());
-    //         verts.push_back(b.y());
-    //
-    //         colors.push_back(col.x());
-    //         colors.push_back(col.y());
-    //         colors.push_back(col.z());
-    //         colors.push_back(col.w());
-    //
-    //         colors.push_back(col.x());
-    //         colors.push_back(col.y());
-    //         colors.push_back(col.z());
-    //         colors.push_back(col.w());
-    //     }
-    // }
+    if(changes.resetPairs && binnedMode)
+        changes.pairs = true;
+
+    statsChanges = StatsChanges();
+    statsInFlight = changes;
+    quint64 serial = ++statsSubmitted;
+
+    Snapshot snap = snapshot();
+    PairHistograms cached;
+    if(!changes.resetPairs)
+        cached = pairHistograms;
+
+    pipeline->submit<StatsResult>(PC_JOB_STATS,
+        [snap, changes, cached](const JobToken &token)
+        {
+            StatsResult result;
+            result.computed = changes;
+
+            Snapshot s = snap;
+            if(changes.minMaxes)
+            {
+                calcMinMaxes(s, s.dimMins, s.dimMaxes);
+                result.dimMins = s.dimMins;
+                result.dimMaxes = s.dimMaxes;
+            }
+            if(changes.histBins && !token.cancelled())
+                calcHistBins(s, result.histograms);
+            if(changes.pairs && !token.cancelled())
+            {
+                result.pairHistograms = cached;
+                calcPairHistograms(s, result.pairHistograms, token);
+            }
+            return result;
+        },
+        [this, serial](const StatsResult &result)
+        {
+            if(serial == statsSubmitted)
+                statsInFlight = StatsChanges();
+
+            if(result.computed.minMaxes)
+            {
+                dimMins = result.dimMins;
+                dimMaxes = result.dimMaxes;
+                lineChanges.rebuild = true;
+            }
+            if(result.computed.histBins)
+                histograms = result.histograms;
+            if(result.computed.pairs)
+                pairHistograms = result.pairHistograms;
+            else if(result.computed.resetPairs)
+                pairHistograms.clear();
+
+            needsRepaint = true;
+            requestFrame();
+        },
+        animationAxis == -1);
+}
+
+void PCVizWidget::submitLinesJob()
+{
+    // Lines are brought up to date once binned mode is switched off, and
+    // wait for the axis ranges when those are being recomputed
+    if(!processed || binnedMode || statsChanges.minMaxes || statsInFlight.minMaxes)
+        return;
+
+    QSize size = plotSize();
+    if(size != linesPlotSize)
+        lineChanges.raster = true;
+
+    if(!lineChanges.any())
+        return;
+
+    LineChanges changes = lineChanges;
+    changes.merge(linesInFlight);
+
+    lineChanges = LineChanges();
+    linesInFlight = changes;
+    linesPlotSize = size;
+    quint64 serial = ++linesSubmitted;
+
+    Snapshot snap = snapshot();
+    std::shared_ptr<LineBuffers> buffers = lineBuffers;
+
+    pipeline->submit<QImage>(PC_JOB_LINES,
+        [snap, changes, buffers](const JobToken &token)
+        {
+            return updateLines(snap, changes, *buffers, token);
+        },
+        [this, serial](const QImage &image)
+        {
+            if(serial == linesSubmitted)
+                linesInFlight = LineChanges();
+
+            lineImage = image;
+            needsRepaint = true;
+            requestFrame();
+        },
+        animationAxis == -1);
 }
 
 void PCVizWidget::showContextMenu(const QPoint &pos)
@@ -557,36 +773,49 @@ void PCVizWidget::showContextMenu(const QPoint &pos)
 
 void PCVizWidget::selectionChangedSlot()
 {
-    needsCalcHistBins = true;
-    needsRecalcLines = true;
+    statsChanges.histBins = true;
+    statsChanges.resetPairs = true;
+    lineChanges.colors = true;
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::visibilityChangedSlot()
 {
     needsProcessData = true;
-    needsCalcMinMaxes = true;
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::setSelOpacity(int val)
 {
     selOpacity = (qreal)val/1000.0;
-    needsRecalcLines = true;
+    lineChanges.colors = true;
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::setUnselOpacity(int val)
 {
     unselOpacity = (qreal)val/1000.0;
-    needsRecalcLines = true;
+    lineChanges.colors = true;
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::setShowHistograms(bool checked)
 {
     showHistograms = checked;
     needsRepaint = true;
+    requestFrame();
+}
+
+void PCVizWidget::setBinnedMode(bool checked)
+{
+    binnedMode = checked;
+    statsChanges.pairs = true;
+    needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::frameUpdate()
@@ -618,30 +847,28 @@ void PCVizWidget::frameUpdate()
         processSelection();
         needsProcessSelection = false;
     }
-    if(needsCalcMinMaxes)
-    {
-        calcMinMaxes();
-        needsCalcMinMaxes = false;
-    }
-    if(needsCalcHistBins)
-    {
-        calcHistBins();
-        needsCalcHistBins = false;
-    }
-    if(needsRecalcLines)
-    {
-        recalcLines();
-        needsRecalcLines = false;
-    }
+
+    // The heavy recomputation runs in background jobs, whose results
+    // arrive through the pipeline and request a repaint
+    submitStatsJob();
+    submitLinesJob();
+
+    // Cleared first, the paint event passes through eventFilter
     if(needsRepaint)
     {
-        repaint();
         needsRepaint = false;
+        repaint();
     }
+
+    // Animations keep requesting frames until they end
+    if(animationAxis != -1)
+        requestFrame();
 }
 
 void PCVizWidget::beginAnimation()
 {
+    // The sweep reselects on every frame; keep it out of the undo history
+    dataSet->beginSelectionBatch();
     animSet.clear();
 
     ElemSet selSet = dataSet->getSelectionSet();
@@ -659,7 +886,7 @@ void PCVizWidget::beginAnimation()
         selSet = dataSet->getSelectionSet();
     }
 
-    std::copy(selSet.begin(),selSet.end(),std::inserter(animSet,animSet.begin()));
+    animSet = selSet;
 
     animationAxis = getClosestAxis(contextMenuMousePos.x());
     movingAxis = -1;
@@ -673,6 +900,7 @@ void PCVizWidget::beginAnimation()
 
     needsProcessSelection = true;
     needsRepaint = true;
+    requestFrame();
 }
 
 void PCVizWidget::endAnimation()
@@ -693,46 +921,15 @@ void PCVizWidget::endAnimation()
 
     dataSet->setSelectionMode(s,true);
     animSet.clear();
+
+    dataSet->endSelectionBatch();
 }
 
+// Lines are rendered by the lines job and drawn by drawQtPainter, so
+// they show up without a GPU
 void PCVizWidget::paintGL()
 {
     glClear(GL_COLOR_BUFFER_BIT);
-
-    if(!processed)
-        return;
-
-    makeCurrent();
-
-    int mx=40;
-    int my=30;
-
-    glViewport(mx,
-               my,
-               width()-2*mx,
-               height()-2*my);
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0.0, 1.0, 0.0, 1.0, 0, 1);
-
-    glShadeModel(GL_FLAT);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-
-    glVertexPointer(FLOATS_PER_POINT,GL_FLOAT,0,verts.constData());
-    glColorPointer(FLOATS_PER_COLOR,GL_FLOAT,0,colors.constData());
-
-    //glDrawArrays(GL_LINES,0,verts.size() / POINTS_PER_LINE);
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
 }
 
 void PCVizWidget::drawQtPainter(QPainter *painter)
@@ -740,13 +937,19 @@ void PCVizWidget::drawQtPainter(QPainter *painter)
     if(!processed)
         return;
 
-    int mx=40;
-    int my=30;
+    int mx=PLOT_MARGIN_X;
+    int my=PLOT_MARGIN_Y;
 
     plotBBox = QRectF(mx,my,
                       width()-mx-mx,
                       height()-my-my);
 
+    // Lines, or bands between bins of adjacent axes
+    if(binnedMode)
+        drawPairHistograms(painter);
+    else if(!lineImage.isNull())
+        painter->drawImage(plotBBox, lineImage);
+
     // Draw axes
     QPointF a = plotBBox.bottomLeft();
     QPointF b = plotBBox.topLeft();
@@ -813,23 +1016,101 @@ void PCVizWidget::drawQtPainter(QPainter *painter)
 
         painter->setPen(Qt::NoPen);
         painter->setBrush(QColor(31,120,180));
-        painter->setOpacity(0.7);
 
-        for(int i=0; i<numDimensions; i++)
+        // With a selection, its distribution is drawn over the faint
+        // distribution of all visible samples, each scaled to its peak
+        bool selection = dataSet->selectionDefined();
+
+        for(int i=0; i<numDimensions && histograms.numBins == numHistBins; i++)
         {
             a.setX(plotBBox.left() + axesPositions[i]*plotBBox.width());
             b.setX(a.x());
 
-            for(int j=0; j<numHistBins; j++)
+            for(int layer=0; layer<(selection ? 2 : 1); layer++)
             {
-                qreal histTop = a.y()-(j+1)*(plotBBox.height()/numHistBins);
-                qreal histLeft = a.x();//-30*histVals[i][j];
-                qreal histBottom = a.y()-(j)*(plotBBox.height()/numHistBins);
-                qreal histRight = a.x()+60*histVals[i][j];
-                painter->drawRect(QRectF(QPointF(histLeft,histTop),QPointF(histRight,histBottom)));
+                bool selLayer = (layer == 1);
+                quint32 maxCount = selLayer ? histograms.maxSelected[i] : histograms.maxVisible[i];
+                if(maxCount == 0)
+                    continue;
+
+                painter->setOpacity(selection && !selLayer ? 0.25 : 0.7);
+
+                for(int j=0; j<numHistBins; j++)
+                {
+                    quint32 count = selLayer ? histograms.selectedAt(i,j) : histograms.visibleAt(i,j);
+                    qreal histTop = a.y()-(j+1)*(plotBBox.height()/numHistBins);
+                    qreal histLeft = a.x();
+                    qreal histBottom = a.y()-(j)*(plotBBox.height()/numHistBins);
+                    qreal histRight = a.x()+60*(qreal)count/maxCount;
+                    painter->drawRect(QRectF(QPointF(histLeft,histTop),QPointF(histRight,histBottom)));
+                }
             }
 
             painter->drawLine(a,b);
         }
     }
 }
+
+// Draws one band per non-empty pair of bins on adjacent axes, opaque in
+// proportion to its log count. Costs O(axes * bins^2) per frame
+// regardless of the number of samples.
+void PCVizWidget::drawPairHistograms(QPainter *painter)
+{
+    painter->save();
+    painter->setPen(Qt::NoPen);
+
+    qreal binHeight = plotBBox.height()/numHistBins;
+    qreal bottom = plotBBox.bottom();
+
+    for(int i=0; i<numDimensions-1; i++)
+    {
+        int axis = axesOrder[i];
+        int nextAxis = axesOrder[i+1];
+        int low = std::min(axis,nextAxis);
+        int high = std::max(axis,nextAxis);
+
+        QHash<int,PairHistogram>::const_iterator it = pairHistograms.constFind(low*numDimensions+high);
+        if(it == pairHistograms.constEnd() || it->maxCount == 0)
+            continue;
+
+        const PairHistogram &hist = *it;
+        bool flipped = (axis != low);
+        qreal logMax = log(1.0 + hist.maxCount);
+
+        qreal xa = plotBBox.left() + axesPositions[axis]*plotBBox.width();
+        qreal xb = plotBBox.left() + axesPositions[nextAxis]*plotBBox.width();
+
+        // Groups in the line colours, selected bands on top of the
+        // unselected ones
+        int numBins = numHistBins*numHistBins;
+        for(int g=0; g<=MAX_SELECTION_GROUPS; g++)
+        {
+            const quint32 *counts = hist.counts.constData() + g*numBins;
+            QColor color = groupColor(g);
+
+            for(int ba=0; ba<numHistBins; ba++)
+            {
+                for(int bb=0; bb<numHistBins; bb++)
+                {
+                    quint32 count = flipped ? counts[bb*numHistBins+ba]
+                                            : counts[ba*numHistBins+bb];
+                    if(count == 0)
+                        continue;
+
+                    color.setAlphaF(BAND_MAX_OPACITY*log(1.0 + count)/logMax);
+                    painter->setBrush(color);
+
+                    QPointF band[4] = {
+                        QPointF(xa, bottom - ba*binHeight),
+                        QPointF(xa, bottom - (ba+1)*binHeight),
+                        QPointF(xb, bottom - (bb+1)*binHeight),
+                        QPointF(xb, bottom - bb*binHeight)
+                    };
+                    painter->drawPolygon(band, 4);
+                }
+            }
+        }
+    }
+
+    painter->restore();
+}
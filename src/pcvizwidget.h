@@ -40,10 +40,14 @@
 #define PCVIZWIDGET_H
 
 #include "vizwidget.h"
+#include "histogram.h"
+#include "linerasterizer.h"
 
 #include <QVector2D>
 #include <QVector4D>
 
+#include <memory>
+
 class PCVizWidget
         : public VizWidget
 {
@@ -67,6 +71,7 @@ public slots:
     void setSelOpacity(int val);
     void setUnselOpacity(int val);
     void setShowHistograms(bool checked);
+    void setBinnedMode(bool checked);
     void beginAnimation();
     void endAnimation();
 
@@ -80,19 +85,126 @@ protected:
     void mouseReleaseEvent(QMouseEvent *e);
     bool eventFilter(QObject *obj, QEvent *event);
 
+private:
+    // Joint histogram of two axes per selection group:
+    // counts[(group*numHistBins + lowBin)*numHistBins + highBin], where
+    // low is the axis with the smaller index and group 0 is unselected
+    struct PairHistogram
+    {
+        QVector<quint32> counts;
+        quint32 maxCount;
+    };
+    typedef QHash<int,PairHistogram> PairHistograms; // by low*numDimensions+high
+
+    // Everything a background job reads, copied on the GUI thread
+    struct Snapshot
+    {
+        const SampleTable *samples;
+        BitMask visibility;
+        QVector<quint8> selection; // group of each sample
+        bool selectionDefined;
+
+        int numDimensions;
+        int numHistBins;
+        QVector<qreal> dimMins;
+        QVector<qreal> dimMaxes;
+        QVector<int> axesOrder;
+        QVector<qreal> axesPositions;
+
+        QVector<QVector4D> groupColors; // by group, 0 is unselected
+        QSize plotSize;
+
+        bool visible(ElemIndex elem) const { return visibility.testBit(elem); }
+        bool selected(ElemIndex elem) const { return selection.at(elem) != 0; }
+    };
+
+    // Statistics still to be computed
+    struct StatsChanges
+    {
+        StatsChanges() : minMaxes(false), histBins(false), pairs(false), resetPairs(false) {}
+
+        bool minMaxes;
+        bool histBins;
+        bool pairs;      // pair histograms missing for adjacent axes
+        bool resetPairs; // cached pair histograms are out of date
+
+        bool any() const { return minMaxes || histBins || pairs || resetPairs; }
+        void merge(const StatsChanges &other);
+    };
+
+    struct StatsResult
+    {
+        StatsChanges computed;
+        QVector<qreal> dimMins;
+        QVector<qreal> dimMaxes;
+        SampleHistograms histograms;
+        PairHistograms pairHistograms;
+    };
+
+    // Line buffer updates still to be made
+    struct LineChanges
+    {
+        LineChanges() : rebuild(false), movedAxes(0), colors(false), raster(false) {}
+
+        bool rebuild;
+        quint32 movedAxes; // bit per axis whose position changed, raster only
+        bool colors;
+        bool raster;
+
+        bool any() const { return rebuild || movedAxes || colors || raster; }
+        void merge(const LineChanges &other);
+    };
+
+    // Lines are stored axis-major as quantised heights, 2 bytes per axis
+    // and line; segments are formed by the rasterizer. Only the lines job
+    // touches them.
+    struct LineBuffers
+    {
+        LineBuffers() : valid(false), numLines(0) {}
+
+        bool valid;
+        QVector<ElemIndex> lineElems;
+        ElemIndex numLines;
+        std::vector<quint16> axisYs;    // [axis*numLines + line], y pointing up
+        std::vector<quint8> lineGroups; // selection group of each line, shared by all segments
+        std::vector<GLfloat> palette;   // RGBA per group, from Snapshot::groupColors
+        LineRasterizer rasterizer;
+    };
+
 private:
     int getClosestAxis(int xval);
     void processSelection();
-    void calcMinMaxes();
-    void calcHistBins();
+    void drawPairHistograms(QPainter *painter);
+
+    Snapshot snapshot();
+    QColor groupColor(int group) const;
+    QSize plotSize() const;
+    void submitStatsJob();
+    void submitLinesJob();
+
+    // Run on worker threads
+    static void calcMinMaxes(const Snapshot &snap, QVector<qreal> &mins, QVector<qreal> &maxes);
+    static void calcHistBins(const Snapshot &snap, SampleHistograms &hists);
+    static void calcPairHistograms(const Snapshot &snap, PairHistograms &pairs, const JobToken &token);
+    static QImage updateLines(const Snapshot &snap, const LineChanges &changes,
+                              LineBuffers &buffers, const JobToken &token);
+    static void recalcAxisHeights(const Snapshot &snap, LineBuffers &buffers, int axis);
+    static void recalcLineColors(const Snapshot &snap, LineBuffers &buffers);
 
 private:
-    bool needsRecalcLines;
-    bool needsCalcHistBins;
-    bool needsCalcMinMaxes;
     bool needsProcessData;
     bool needsProcessSelection;
 
+    // Requested work, and work handed to jobs that have not delivered
+    // yet. A new job takes over both, since it may cancel the old one.
+    StatsChanges statsChanges;
+    StatsChanges statsInFlight;
+    quint64 statsSubmitted;
+    LineChanges lineChanges;
+    LineChanges linesInFlight;
+    quint64 linesSubmitted;
+    QSize linesPlotSize;
+
     ElemSet animSet;
     bool emptySet;
 
@@ -102,8 +214,10 @@ private:
     QRectF plotBBox;
     ColorMap colorMap;
 
-    QVector<QVector<qreal> > histVals;
-    QVector<qreal> histMaxVals;
+    bool binnedMode;
+    PairHistograms pairHistograms;
+
+    SampleHistograms histograms;
 
     QVector<qreal> dimMins;
     QVector<qreal> dimMaxes;
@@ -132,9 +246,9 @@ private:
     qreal selOpacity;
     qreal unselOpacity;
 
-    // OpenGL
-    QVector<GLfloat> verts;
-    QVector<GLfloat> colors;
+    // Lines as last rendered by the lines job
+    std::shared_ptr<LineBuffers> lineBuffers;
+    QImage lineImage;
 };
 
 #endif // PARALLELCOORDINATESVIZ_H
@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+#include "pipeline.h"
+
+#include <QMetaObject>
+#include <QRunnable>
+#include <QThreadPool>
+
+class ComputePipeline::Task : public QRunnable
+{
+public:
+    Task(ComputePipeline *pipeline, Job *job) : pipeline(pipeline), job(job) {}
+
+    void run()
+    {
+        // Jobs superseded while queued in the pool are skipped
+        if(!job->token.cancelled())
+            job->run();
+        pipeline->finish(job);
+    }
+
+private:
+    ComputePipeline *pipeline;
+    Job *job;
+};
+
+ComputePipeline::ComputePipeline(QObject *parent)
+    : QObject(parent)
+{
+    numRunning = 0;
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    cancelAll();
+    waitForDone();
+
+    for(int i=0; i<finished.size(); i++)
+        delete finished[i];
+}
+
+bool ComputePipeline::pending(int key) const
+{
+    QHash<int,Channel>::const_iterator it = channels.constFind(key);
+    return it != channels.constEnd() && (it->running != NULL || it->queued != NULL);
+}
+
+void ComputePipeline::cancelAll()
+{
+    QHash<int,Channel>::iterator it;
+    for(it = channels.begin(); it != channels.end(); ++it)
+    {
+        it->cancelBelow->store(it->lastGeneration+1);
+        delete it->queued;
+        it->queued = NULL;
+    }
+}
+
+void ComputePipeline::waitForDone()
+{
+    QMutexLocker locker(&mutex);
+    while(numRunning > 0)
+        idle.wait(&mutex);
+}
+
+// A job waits behind the running one of its key, replacing any job
+// that was already waiting
+void ComputePipeline::enqueue(Job *job)
+{
+    Channel &channel = channels[job->key];
+    if(channel.running != NULL)
+    {
+        delete channel.queued;
+        channel.queued = job;
+    }
+    else
+    {
+        start(job);
+    }
+}
+
+void ComputePipeline::start(Job *job)
+{
+    channels[job->key].running = job;
+
+    mutex.lock();
+    numRunning++;
+    mutex.unlock();
+
+    QThreadPool::globalInstance()->start(new Task(this, job));
+}
+
+// Called on the worker thread. The delivery is posted before the job
+// counts as done, so waitForDone() cannot return (and the pipeline be
+// destroyed) while this thread still uses it; a destroyed pipeline drops
+// its posted deliveries.
+void ComputePipeline::finish(Job *job)
+{
+    QMutexLocker locker(&mutex);
+    finished.append(job);
+    QMetaObject::invokeMethod(this, "deliverFinished", Qt::QueuedConnection);
+
+    numRunning--;
+    if(numRunning == 0)
+        idle.wakeAll();
+}
+
+void ComputePipeline::deliverFinished()
+{
+    mutex.lock();
+    QList<Job*> jobs = finished;
+    finished.clear();
+    mutex.unlock();
+
+    for(int i=0; i<jobs.size(); i++)
+    {
+        Job *job = jobs[i];
+        Channel &channel = channels[job->key];
+        channel.running = NULL;
+
+        Job *next = channel.queued;
+        channel.queued = NULL;
+        if(next != NULL)
+            start(next);
+
+        // May submit again, so channel is not used past this point
+        if(!job->token.cancelled())
+            job->deliver();
+        delete job;
+    }
+}
@@ -0,0 +1,156 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Handed to a running job so it can stop early once superseded
+class JobToken
+{
+public:
+    JobToken(std::shared_ptr<std::atomic<quint64> > cancelBelow, quint64 generation)
+        : cancelBelow(cancelBelow), generation(generation) {}
+
+    bool cancelled() const { return generation < cancelBelow->load(); }
+
+private:
+    std::shared_ptr<std::atomic<quint64> > cancelBelow;
+    quint64 generation;
+};
+
+// Runs recompute jobs for a widget on the global thread pool and hands
+// their results back on the thread the pipeline lives in (the GUI
+// thread). Jobs are grouped by key: a key runs one job at a time and
+// keeps at most one more queued, which a newer submit replaces. A submit
+// also cancels the running job unless cancelRunning is false, which
+// lets continuous updates such as animations still show intermediate
+// results. Cancelled jobs' results are never delivered. Jobs must not
+// touch widget state; they get everything they read as a snapshot and
+// return their result by value.
+class ComputePipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    ComputePipeline(QObject *parent = 0);
+    ~ComputePipeline();
+
+    template <typename Result>
+    void submit(int key,
+                std::function<Result(const JobToken &)> compute,
+                std::function<void(const Result &)> done,
+                bool cancelRunning = true);
+
+    // Whether a job for key is queued or running
+    bool pending(int key) const;
+
+    // Cancels every job and drops queued ones; results still in flight
+    // are not delivered
+    void cancelAll();
+    void waitForDone();
+
+private slots:
+    void deliverFinished();
+
+private:
+    struct Job
+    {
+        int key;
+        quint64 generation;
+        JobToken token;
+        std::function<void()> run;
+        std::function<void()> deliver;
+    };
+
+    struct Channel
+    {
+        Channel() : cancelBelow(new std::atomic<quint64>(0)), lastGeneration(0),
+                    running(NULL), queued(NULL) {}
+
+        std::shared_ptr<std::atomic<quint64> > cancelBelow;
+        quint64 lastGeneration;
+        Job *running;
+        Job *queued;
+    };
+
+    class Task;
+
+    void enqueue(Job *job);
+    void start(Job *job);
+    void finish(Job *job);
+
+private:
+    QHash<int,Channel> channels;
+
+    // Shared with the worker threads
+    QMutex mutex;
+    QWaitCondition idle;
+    QList<Job*> finished;
+    int numRunning;
+};
+
+template <typename Result>
+void ComputePipeline::submit(int key,
+                             std::function<Result(const JobToken &)> compute,
+                             std::function<void(const Result &)> done,
+                             bool cancelRunning)
+{
+    Channel &channel = channels[key];
+    quint64 generation = ++channel.lastGeneration;
+    if(cancelRunning)
+        channel.cancelBelow->store(generation);
+
+    std::shared_ptr<Result> result(new Result());
+    JobToken token(channel.cancelBelow, generation);
+
+    Job *job = new Job{key, generation, token,
+                       [compute, token, result]() { *result = compute(token); },
+                       [done, result]() { done(*result); }};
+    enqueue(job);
+}
+
+#endif // PIPELINE_H
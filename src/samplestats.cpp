@@ -0,0 +1,380 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "samplestats.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+AxisMoments::AxisMoments()
+{
+    count = 0;
+    sum = 0;
+    mean = 0;
+    m2 = 0;
+    min = std::numeric_limits<qreal>::max();
+    max = std::numeric_limits<qreal>::lowest();
+}
+
+qreal AxisMoments::stddev() const
+{
+    return sqrt(variance());
+}
+
+void AxisMoments::merge(const AxisMoments &other)
+{
+    if(other.count == 0)
+        return;
+    if(count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    qreal n = count + other.count;
+    qreal delta = other.mean - mean;
+    mean += delta * other.count / n;
+    m2 += other.m2 + delta*delta * ((qreal)count * other.count / n);
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+// Moments of one block of values; the block fits in L1 so the
+// two passes (mean, then deviations) read it from cache
+static AxisMoments blockMoments(const double *x, int n)
+{
+    AxisMoments m;
+    if(n == 0)
+        return m;
+
+    double sum = 0, lo = x[0], hi = x[0];
+    int i = 0;
+#if defined(__SSE2__)
+    __m128d vsum = _mm_setzero_pd();
+    __m128d vlo = _mm_set1_pd(x[0]);
+    __m128d vhi = vlo;
+    for(; i+2 <= n; i += 2)
+    {
+        __m128d v = _mm_loadu_pd(x+i);
+        vsum = _mm_add_pd(vsum, v);
+        vlo = _mm_min_pd(vlo, v);
+        vhi = _mm_max_pd(vhi, v);
+    }
+    double s[2], l[2], h[2];
+    _mm_storeu_pd(s, vsum);
+    _mm_storeu_pd(l, vlo);
+    _mm_storeu_pd(h, vhi);
+    sum = s[0] + s[1];
+    lo = std::min(l[0], l[1]);
+    hi = std::max(h[0], h[1]);
+#endif
+    for(; i<n; i++)
+    {
+        sum += x[i];
+        lo = std::min(lo, x[i]);
+        hi = std::max(hi, x[i]);
+    }
+
+    double mean = sum / n;
+    double m2 = 0;
+    i = 0;
+#if defined(__SSE2__)
+    __m128d vmean = _mm_set1_pd(mean);
+    __m128d vm2 = _mm_setzero_pd();
+    for(; i+2 <= n; i += 2)
+    {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(x+i), vmean);
+        vm2 = _mm_add_pd(vm2, _mm_mul_pd(d, d));
+    }
+    _mm_storeu_pd(s, vm2);
+    m2 = s[0] + s[1];
+#endif
+    for(; i<n; i++)
+        m2 += (x[i]-mean)*(x[i]-mean);
+
+    m.count = n;
+    m.sum = sum;
+    m.mean = mean;
+    m.m2 = m2;
+    m.min = lo;
+    m.max = hi;
+    return m;
+}
+
+CoMoments::CoMoments()
+{
+    count = 0;
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+    {
+        mean[i] = 0;
+        for(int j=0; j<NUM_SAMPLE_AXES; j++)
+            c[i][j] = 0;
+    }
+}
+
+qreal CoMoments::correlation(int i, int j) const
+{
+    qreal denom = sqrt(c[i][i]*c[j][j]);
+    return denom > 0 ? c[i][j]/denom : 0;
+}
+
+void CoMoments::merge(const CoMoments &other)
+{
+    if(other.count == 0)
+        return;
+    if(count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    qreal n = count + other.count;
+    qreal w = (qreal)count * other.count / n;
+    qreal delta[NUM_SAMPLE_AXES];
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        delta[i] = other.mean[i] - mean[i];
+
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        for(int j=0; j<NUM_SAMPLE_AXES; j++)
+            c[i][j] += other.c[i][j] + delta[i]*delta[j]*w;
+
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        mean[i] += delta[i] * other.count / n;
+    count += other.count;
+}
+
+void CoMoments::add(const qreal *x)
+{
+    count++;
+    qreal delta[NUM_SAMPLE_AXES];
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+    {
+        delta[i] = x[i] - mean[i];
+        mean[i] += delta[i] / count;
+    }
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        for(int j=0; j<NUM_SAMPLE_AXES; j++)
+            c[i][j] += delta[i] * (x[j] - mean[j]);
+}
+
+void CoMoments::remove(const qreal *x)
+{
+    if(count <= 1)
+    {
+        *this = CoMoments();
+        return;
+    }
+
+    // Inverse of add(): recover the previous means, then subtract the
+    // product add() contributed against the current ones
+    count--;
+    qreal prevMean[NUM_SAMPLE_AXES];
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        prevMean[i] = mean[i] - (x[i] - mean[i]) / count;
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        for(int j=0; j<NUM_SAMPLE_AXES; j++)
+            c[i][j] -= (x[i] - prevMean[i]) * (x[j] - mean[j]);
+    for(int i=0; i<NUM_SAMPLE_AXES; i++)
+        mean[i] = prevMean[i];
+}
+
+static double dot(const double *x, const double *y, int n)
+{
+    double sum = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for(; i+4 <= n; i += 4)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x+i), _mm_loadu_pd(y+i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x+i+2), _mm_loadu_pd(y+i+2)));
+    }
+    double s[2];
+    _mm_storeu_pd(s, _mm_add_pd(acc0, acc1));
+    sum = s[0] + s[1];
+#endif
+    for(; i<n; i++)
+        sum += x[i]*y[i];
+    return sum;
+}
+
+// Rows visited by a statistics pass: all of them, or the gathered subset,
+// split into one contiguous range per worker
+struct StatsRows
+{
+    StatsRows(const SampleTable &samples, const ElemSet *subset);
+
+    // Copies rows [first,first+n) of one axis into block as doubles
+    void gather(const SampleTable &samples, int axis, long long first, int n, double *block) const;
+
+    bool useSubset;
+    std::vector<ElemIndex> rows;
+    long long numRows;
+    int numWorkers;
+};
+
+StatsRows::StatsRows(const SampleTable &samples, const ElemSet *subset)
+{
+    useSubset = (subset != NULL);
+    if(useSubset)
+    {
+        rows.reserve(subset->size());
+        subset->forEach([&](ElemIndex elem) { rows.push_back(elem); });
+    }
+    numRows = useSubset ? (long long)rows.size() : (long long)samples.size();
+    numWorkers = std::max(1LL, std::min((long long)numWorkerThreads(), numRows));
+}
+
+void StatsRows::gather(const SampleTable &samples, int axis, long long first, int n, double *block) const
+{
+    const long long *vals = samples.column(axis);
+    if(useSubset)
+    {
+        for(int i=0; i<n; i++)
+            block[i] = vals[rows[first+i]];
+    }
+    else
+    {
+        for(int i=0; i<n; i++)
+            block[i] = vals[first+i];
+    }
+}
+
+void calcAxisMoments(const SampleTable &samples, const ElemSet *subset, AxisMoments *moments)
+{
+    StatsRows rows(samples, subset);
+    std::vector<std::vector<AxisMoments> > workerMoments(rows.numWorkers, std::vector<AxisMoments>(NUM_SAMPLE_AXES));
+
+    parallelChunks(rows.numRows, rows.numWorkers, [&](int worker, long long begin, long long end)
+    {
+        std::vector<AxisMoments> &local = workerMoments[worker];
+        double block[STATS_BLOCK_SIZE];
+
+        for(long long first=begin; first<end; first+=STATS_BLOCK_SIZE)
+        {
+            int n = (int)std::min((long long)STATS_BLOCK_SIZE, end-first);
+            for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+            {
+                rows.gather(samples, axis, first, n, block);
+                local[axis].merge(blockMoments(block, n));
+            }
+        }
+    });
+
+    // Merge in worker order so results do not depend on scheduling
+    for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+    {
+        moments[axis] = AxisMoments();
+        for(int w=0; w<rows.numWorkers; w++)
+            moments[axis].merge(workerMoments[w][axis]);
+    }
+}
+
+void calcCoMoments(const SampleTable &samples, const ElemSet *subset, CoMoments &moments)
+{
+    StatsRows rows(samples, subset);
+    std::vector<CoMoments> workerMoments(rows.numWorkers);
+
+    parallelChunks(rows.numRows, rows.numWorkers, [&](int worker, long long begin, long long end)
+    {
+        CoMoments &local = workerMoments[worker];
+        std::vector<double> blockData(NUM_SAMPLE_AXES*STATS_BLOCK_SIZE);
+
+        for(long long first=begin; first<end; first+=STATS_BLOCK_SIZE)
+        {
+            int n = (int)std::min((long long)STATS_BLOCK_SIZE, end-first);
+
+            // Center each axis of the block on its block mean, then the
+            // co-moments are dot products of contiguous rows
+            CoMoments b;
+            b.count = n;
+            for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+            {
+                double *x = &blockData[axis*STATS_BLOCK_SIZE];
+                rows.gather(samples, axis, first, n, x);
+
+                double sum = 0;
+                for(int i=0; i<n; i++)
+                    sum += x[i];
+                b.mean[axis] = sum / n;
+                for(int i=0; i<n; i++)
+                    x[i] -= b.mean[axis];
+            }
+
+            for(int i=0; i<NUM_SAMPLE_AXES; i++)
+            {
+                for(int j=i; j<NUM_SAMPLE_AXES; j++)
+                {
+                    b.c[i][j] = dot(&blockData[i*STATS_BLOCK_SIZE], &blockData[j*STATS_BLOCK_SIZE], n);
+                    b.c[j][i] = b.c[i][j];
+                }
+            }
+
+            local.merge(b);
+        }
+    });
+
+    moments = CoMoments();
+    for(int w=0; w<rows.numWorkers; w++)
+        moments.merge(workerMoments[w]);
+}
+
+void updateCoMoments(const SampleTable &samples, const ElemSet &added, const ElemSet &removed, CoMoments &moments)
+{
+    qreal x[NUM_SAMPLE_AXES];
+    removed.forEach([&](ElemIndex elem)
+    {
+        for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+            x[axis] = samples.value(elem, axis);
+        moments.remove(x);
+    });
+    added.forEach([&](ElemIndex elem)
+    {
+        for(int axis=0; axis<NUM_SAMPLE_AXES; axis++)
+            x[axis] = samples.value(elem, axis);
+        moments.add(x);
+    });
+}
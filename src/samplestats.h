@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLESTATS_H
+#define SAMPLESTATS_H
+
+#include <QtGlobal>
+
+#include "elemset.h"
+#include "sampletable.h"
+
+// Rows gathered per axis before a block is reduced
+#define STATS_BLOCK_SIZE 256
+
+// Count, extrema and central moments of one axis. Partial results merge
+// with Chan et al.'s pairwise update, which stays numerically stable.
+struct AxisMoments
+{
+    AxisMoments();
+
+    ElemIndex count;
+    qreal sum;
+    qreal mean;
+    qreal m2; // sum of squared deviations from the mean
+    qreal min;
+    qreal max;
+
+    qreal variance() const { return count ? m2/count : 0; }
+    qreal stddev() const;
+
+    void merge(const AxisMoments &other);
+};
+
+// Means and co-moments (sums of products of deviations from the means)
+// of all axes, from which the covariance and correlation matrices follow.
+// Partial results merge like AxisMoments.
+struct CoMoments
+{
+    CoMoments();
+
+    ElemIndex count;
+    qreal mean[NUM_SAMPLE_AXES];
+    qreal c[NUM_SAMPLE_AXES][NUM_SAMPLE_AXES];
+
+    qreal covariance(int i, int j) const { return count ? c[i][j]/count : 0; }
+    qreal correlation(int i, int j) const;
+
+    void merge(const CoMoments &other);
+
+    // Welford updates for one row of NUM_SAMPLE_AXES values; remove()
+    // undoes an earlier add() of the same row
+    void add(const qreal *x);
+    void remove(const qreal *x);
+};
+
+// One pass over every axis of all samples (subset == NULL) or of the
+// samples in subset, split across worker threads. moments must hold
+// NUM_SAMPLE_AXES entries.
+void calcAxisMoments(const SampleTable &samples, const ElemSet *subset, AxisMoments *moments);
+
+// Same for the full NUM_SAMPLE_AXES x NUM_SAMPLE_AXES co-moment matrix
+void calcCoMoments(const SampleTable &samples, const ElemSet *subset, CoMoments &moments);
+
+// Moves moments computed over some set S to S + added - removed. Costs
+// O(|delta| * NUM_SAMPLE_AXES^2); added must be disjoint from S and
+// removed contained in it.
+void updateCoMoments(const SampleTable &samples, const ElemSet &added, const ElemSet &removed, CoMoments &moments);
+
+#endif // SAMPLESTATS_H
@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLETABLE_H
+#define SAMPLETABLE_H
+
+#include <QStringList>
+
+#include <vector>
+
+#include "elemset.h"
+
+#define NUM_SAMPLE_AXES 19
+
+namespace SampleAxes
+{
+    enum SampleAxes{ //#define NUM_SAMPLE_AXES 19
+        sampleId = 0,
+        sourceUid = 1,
+        line = 2,
+        instructionUid = 3,
+        bytes = 4,
+        ip = 5,
+        variableUid = 6,
+        buffer_size = 7,
+        dims = 8,
+        xidx = 9,
+        yidx = 10,
+        zidx = 11,
+        pid = 12,
+        tid = 13,
+        time = 14,
+        addr = 15,
+        cpu = 16,
+        latency = 17,
+        dataSrc = 18
+    };
+    const QStringList SampleAxesNames = {
+        "sample ID", //0
+        "source file UID", //1
+        "source line", //2
+        "instruction UID", //3
+        "bytes", //4
+        "instruction pointer", //5
+        "variable UID", //6
+        "buffer size", //7
+        "#dims", //8
+        "x-index", //9
+        "y-index", //10
+        "z-index", //11
+        "PID", //12
+        "TID", //13
+        "timestamp", //14
+        "data address", //15
+        "CPU core", //16
+        "load latency", //17
+        "data source" //18
+    };
+}
+
+// Structure-of-arrays sample storage: one contiguous array per
+// SampleAxes axis, so scanning a single axis is a sequential read
+class SampleTable
+{
+public:
+    SampleTable();
+
+    ElemIndex size() const { return numRows; }
+    bool empty() const { return numRows == 0; }
+
+    void clear();
+    void reserve(ElemIndex n);
+    void resize(ElemIndex n);
+    void append(const long long *row);
+
+    long long *column(int axis) { return columns[axis].data(); }
+    const long long *column(int axis) const { return columns[axis].data(); }
+
+    long long value(ElemIndex row, int axis) const { return columns[axis][row]; }
+    void setValue(ElemIndex row, int axis, long long val) { columns[axis][row] = val; }
+
+private:
+    ElemIndex numRows;
+    std::vector<long long> columns[NUM_SAMPLE_AXES];
+};
+
+#endif // SAMPLETABLE_H
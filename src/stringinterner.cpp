@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "stringinterner.h"
+
+quint32 StringInterner::intern(const char *begin, const char *end)
+{
+    // fromRawData wraps the buffer without copying it for the lookup
+    QByteArray key = QByteArray::fromRawData(begin, end-begin);
+    QHash<QByteArray,quint32>::const_iterator it = ids.constFind(key);
+    if(it != ids.constEnd())
+        return it.value();
+
+    quint32 id = strings.size();
+    ids.insert(QByteArray(begin, end-begin), id);
+    strings.push_back(QString::fromUtf8(begin, end-begin));
+    return id;
+}
+
+quint32 StringInterner::intern(const QString &str)
+{
+    QByteArray utf8 = str.toUtf8();
+    return intern(utf8.constData(), utf8.constData()+utf8.size());
+}
+
+int StringInterner::find(const QString &str) const
+{
+    QHash<QByteArray,quint32>::const_iterator it = ids.constFind(str.toUtf8());
+    return (it == ids.constEnd()) ? -1 : (int)it.value();
+}
+
+void StringInterner::clear()
+{
+    ids.clear();
+    strings.clear();
+}
+
+void StringInterner::reserve(int n)
+{
+    ids.reserve(n);
+    strings.reserve(n);
+}
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Maps strings to dense 32-bit IDs (0,1,2,... in first-seen order) and back.
+// Lookups hash the UTF-8 bytes, so interning a name straight from a parse
+// buffer only allocates the first time that name is seen.
+class StringInterner
+{
+public:
+    StringInterner() {}
+
+    quint32 intern(const char *begin, const char *end);
+    quint32 intern(const QString &str);
+
+    // ID of str, or -1 if it was never interned
+    int find(const QString &str) const;
+
+    const QString &at(quint32 id) const { return strings.at(id); }
+    int size() const { return strings.size(); }
+    bool contains(quint32 id) const { return id < (quint32)strings.size(); }
+
+    void clear();
+    void reserve(int n);
+
+private:
+    QHash<QByteArray,quint32> ids;
+    QVector<QString> strings;
+};
+
+#endif // STRINGINTERNER_H
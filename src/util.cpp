@@ -145,6 +145,32 @@ QColor valToColor(qreal val, ColorMap colorMap)
     return colorMap.at(colIdx);
 }
 
+QColor valToColor(qreal val, qreal min, qreal max, QColor minColor, QColor maxColor)
+{
+    qreal t = (max > min) ? clamp(normalize(val,min,max),0,1) : 0;
+
+    return QColor(minColor.red()+(maxColor.red()-minColor.red())*t,
+                  minColor.green()+(maxColor.green()-minColor.green())*t,
+                  minColor.blue()+(maxColor.blue()-minColor.blue())*t);
+}
+
+QColor selectionGroupColor(int group)
+{
+    static const QColor groupColors[] = {
+        QColor(255,0,0),
+        QColor(31,120,180),
+        QColor(51,160,44),
+        QColor(255,127,0),
+        QColor(106,61,154),
+        QColor(177,89,40),
+        QColor(231,41,138),
+        QColor(0,170,170)
+    };
+    const int numColors = sizeof(groupColors)/sizeof(groupColors[0]);
+
+    return groupColors[(std::max(group,1)-1) % numColors];
+}
+
 QPointF radialTransform(QPointF point, QRectF rectSpace)
 {
     // Get radius
@@ -70,5 +70,9 @@ QVector<QPointF> rectToRadialSegment(QRectF rect, QRectF rectSpace);
 
 ColorMap gradientColorMap(QColor col0, QColor col1, int steps);
 QColor valToColor(qreal val, ColorMap colorMap);
+QColor valToColor(qreal val, qreal min, qreal max, QColor minColor, QColor maxColor);
+
+// Colour of selection group 1..n (group 1 is red)
+QColor selectionGroupColor(int group);
 
 #endif // UTIL_H
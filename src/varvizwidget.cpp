@@ -87,14 +87,22 @@ void VarViz::processData()
     varMaxVal = 0;
     varBlocks.clear();
 
+    const long long *variableUids = dataSet->samples.column(SampleAxes::variableUid);
+    const long long *latencies = dataSet->samples.column(SampleAxes::latency);
+
+    // Block of each variable UID, looked up on first use
+    QVector<int> varIdxByUid(dataSet->variableNames.size(),-1);
+
     // Get metric values
-    for(Sample s: dataSet->samples)
+    for(ElemIndex elem=0; elem<dataSet->samples.size(); elem++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(s.sampleId))
+        if(dataSet->selectionDefined() && !dataSet->selected(elem))
             continue;
 
-        int varIdx = this->getVariableID(s.variable);
-        varBlocks[varIdx].val += s.latency;
+        int &varIdx = varIdxByUid[variableUids[elem]];
+        if(varIdx == -1)
+            varIdx = this->getVariableID(dataSet->variableNames.at(variableUids[elem]));
+        varBlocks[varIdx].val += latencies[elem];
         varMaxVal = std::max(varMaxVal,varBlocks[varIdx].val);
 
     }
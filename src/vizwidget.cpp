@@ -37,6 +37,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "vizwidget.h"
+#include "framescheduler.h"
 
 #include <iostream>
 using namespace std;
@@ -57,10 +58,13 @@ VizWidget::VizWidget(QWidget *parent) :
     needsRepaint = false;
 
     dataSet = NULL;
+    frameScheduler = NULL;
+    pipeline = new ComputePipeline(this);
 }
 
 VizWidget::~VizWidget()
 {
+    cancelJobs();
 }
 
 QSize VizWidget::sizeHint() const
@@ -80,11 +84,13 @@ void VizWidget::frameUpdate()
 void VizWidget::selectionChangedSlot()
 {
     needsRepaint = true;
+    requestFrame();
 }
 
 void VizWidget::visibilityChangedSlot()
 {
     needsRepaint = true;
+    requestFrame();
 }
 
 void VizWidget::initializeGL()
@@ -144,10 +150,27 @@ void VizWidget::setConsole(console *iCon)
     con = iCon;
 }
 
+void VizWidget::setFrameScheduler(FrameScheduler *iScheduler)
+{
+    frameScheduler = iScheduler;
+}
+
 void VizWidget::processData()
 {
 }
 
+void VizWidget::requestFrame()
+{
+    if(frameScheduler)
+        frameScheduler->requestFrame(this);
+}
+
+void VizWidget::cancelJobs()
+{
+    pipeline->cancelAll();
+    pipeline->waitForDone();
+}
+
 void VizWidget::paintGL()
 {
 }
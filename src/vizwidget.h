@@ -42,6 +42,10 @@
 #include <QGLWidget>
 
 #include "dataobject.h"
+#include "console.h"
+#include "pipeline.h"
+
+class FrameScheduler;
 
 class VizWidget : public QGLWidget
 {
@@ -64,8 +68,13 @@ public slots:
 public:
     void setDataSet(DataObject *iDataSet);
     void setConsole(console *iCon);
+    void setFrameScheduler(FrameScheduler *iScheduler);
     virtual void processData();
 
+    // Cancels background jobs and waits for running ones, e.g. before
+    // the data set they read is reloaded
+    void cancelJobs();
+
 protected:
     void initializeGL();
     void paintEvent(QPaintEvent *event);
@@ -74,6 +83,9 @@ protected:
     virtual void drawNativeGL();
     virtual void drawQtPainter(QPainter *painter);
 
+    // Schedules a frameUpdate; call after marking work as pending
+    void requestFrame();
+
 private:
     void beginNativeGL();
     void endNativeGL();
@@ -82,6 +94,8 @@ protected:
     bool processed;
     console *con;
     DataObject *dataSet;
+    ComputePipeline *pipeline;
+    FrameScheduler *frameScheduler;
 
     int margin;
     QColor bgColor;